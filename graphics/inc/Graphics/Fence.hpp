@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Config.hpp"
+
+#include <atomic>
+
+namespace Graphics
+{
+/// <summary>
+/// A fence is used to synchronize two threads: one thread signals the fence when it is done with
+/// a resource, and the other thread waits for the fence before it uses the resource again.
+/// The rasterizer uses fences to hand finished frames to their consumer (see Rasterizer::present).
+/// </summary>
+class SR_API Fence
+{
+public:
+    /// <summary>
+    /// Create a fence.
+    /// </summary>
+    /// <param name="signaled">The initial state of the fence.</param>
+    explicit Fence( bool signaled = true ) noexcept;
+
+    Fence( const Fence& )            = delete;
+    Fence& operator=( const Fence& ) = delete;
+
+    /// <summary>
+    /// Signal the fence and wake up the threads that are waiting for it.
+    /// </summary>
+    void signal() noexcept;
+
+    /// <summary>
+    /// Reset the fence to the unsignaled state.
+    /// </summary>
+    void reset() noexcept;
+
+    /// <summary>
+    /// Check if the fence is signaled (without blocking).
+    /// </summary>
+    /// <returns>`true` if the fence is signaled.</returns>
+    bool isSignaled() const noexcept;
+
+    /// <summary>
+    /// Block the calling thread until the fence is signaled.
+    /// </summary>
+    void wait() const noexcept;
+
+private:
+    std::atomic<bool> signaled;
+};
+}  // namespace Graphics
@@ -2,6 +2,7 @@
 
 #include "Config.hpp"
 #include "Image.hpp"
+#include "Texture.hpp"
 
 namespace Graphics
 {
@@ -13,8 +14,8 @@ struct SR_API Material final
         const Color& ambientColor  = Color::Black,
         const Color& emissiveColor = Color::Black,
         float        specularPower = -1.0f,
-        std::shared_ptr<Image> diffuseTexture = nullptr,
-        std::shared_ptr<Image> alphaTexture = nullptr,
+        std::shared_ptr<Texture> diffuseTexture = nullptr,
+        std::shared_ptr<Texture> alphaTexture = nullptr,
         std::shared_ptr<Image> specularTexture = nullptr,
         std::shared_ptr<Image> normalTexture = nullptr,
         std::shared_ptr<Image> ambientTexture = nullptr,
@@ -33,8 +34,9 @@ struct SR_API Material final
     Color emissiveColor;
     float specularPower;
 
-    std::shared_ptr<Image> diffuseTexture;
-    std::shared_ptr<Image> alphaTexture;
+    // The textures that are sampled by the rasterizer have a mip chain.
+    std::shared_ptr<Texture> diffuseTexture;
+    std::shared_ptr<Texture> alphaTexture;
     std::shared_ptr<Image> specularTexture;
     std::shared_ptr<Image> normalTexture;
     std::shared_ptr<Image> ambientTexture;
@@ -4,6 +4,11 @@
 #include "Material.hpp"
 #include "Vertex.hpp"
 
+#include <Math/AABB.hpp>
+#include <Math/Sphere.hpp>
+
+#include <cstdint>
+#include <memory>
 #include <span>
 #include <vector>
 
@@ -12,6 +17,41 @@ namespace Graphics
 class SR_API Mesh final
 {
 public:
+    /// <summary>
+    /// The maximum number of vertices and triangles in a meshlet.
+    /// </summary>
+    static constexpr std::size_t MaxMeshletVertices  = 64;
+    static constexpr std::size_t MaxMeshletTriangles = 128;
+
+    /// <summary>
+    /// A meshlet is a cluster of neighboring triangles of the mesh that is culled as a whole.
+    /// The triangles of a meshlet are stored contiguously in the index buffer, and the vertices
+    /// are stored in the order they are first used by the meshlets.
+    /// </summary>
+    struct Meshlet
+    {
+        std::uint32_t firstIndex = 0u;  // The first index of the meshlet in the index buffer.
+        std::uint32_t indexCount = 0u;  // The number of indices (3 per triangle).
+
+        Math::AABB   aabb;
+        Math::Sphere sphere;
+
+        // The normal cone: the axis is the average normal of the triangles, and the cutoff is the sine of the
+        // largest angle between the axis and the triangle normals (or 1 if the triangles can't be backface culled together).
+        glm::vec3 coneAxis { 0.0f };
+        float     coneCutoff = 1.0f;
+    };
+
+    /// <summary>
+    /// A simplified level of detail of a mesh.
+    /// </summary>
+    struct LOD
+    {
+        std::shared_ptr<Mesh> mesh;
+        /// The simplification error relative to the size (diagonal of the AABB) of the original mesh.
+        float error = 0.0f;
+    };
+
     /// <summary>
     /// Load a mesh from a given set of vertices and (optionally) a set of vertices.
     /// </summary>
@@ -56,6 +96,31 @@ public:
         return indexBuffer.size();
     }
 
+    /// <summary>
+    /// Get the meshlets of this mesh.
+    /// The meshlets are built when the mesh is loaded, and cover all of the triangles of the mesh.
+    /// </summary>
+    /// <returns>The meshlets of the mesh.</returns>
+    const std::vector<Meshlet>& getMeshlets() const noexcept;
+
+    /// <summary>
+    /// Generate a chain of simplified levels of detail for this mesh (using quadric error simplification).
+    /// Each level is simplified from the previous level. Fewer levels are generated if the mesh can't be simplified further.
+    /// </summary>
+    /// <param name="numLODs">The (maximum) number of levels to generate (not counting this mesh).</param>
+    /// <param name="reduction">The number of triangles of each level relative to the previous level.</param>
+    void generateLODs( std::size_t numLODs, float reduction = 0.5f );
+
+    const std::vector<LOD>& getLODs() const noexcept;
+
+    /// <summary>
+    /// Select the coarsest level of detail whose (projected) simplification error is below a threshold.
+    /// </summary>
+    /// <param name="screenSize">The projected size of the mesh (in pixels).</param>
+    /// <param name="threshold">The largest acceptable error (in pixels).</param>
+    /// <returns>The selected level of detail, or this mesh if none of the levels are accurate enough.</returns>
+    const Mesh& selectLOD( float screenSize, float threshold ) const noexcept;
+
 private:
     // std::vector<Vertex3D> vertexBuffer;
     std::vector<glm::vec3> positions;
@@ -68,5 +133,8 @@ private:
     std::vector<int>          indexBuffer;
     std::shared_ptr<Material> material;
     Math::AABB                aabb;
+
+    std::vector<Meshlet> meshlets;
+    std::vector<LOD>     lods;
 };
 }  // namespace Graphics
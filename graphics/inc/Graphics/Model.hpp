@@ -24,7 +24,9 @@ namespace Graphics
         /// Load a model from a file.
         /// </summary>
         /// <param name="modelFile">The file path to the model to load.</param>
-        explicit Model( const std::filesystem::path& modelFile );
+        /// <param name="numLODs">The number of simplified levels of detail to generate for each mesh (see Mesh::generateLODs).</param>
+        /// <param name="textureLayout">The memory layout of the textures of the materials (see TextureLayout).</param>
+        explicit Model( const std::filesystem::path& modelFile, std::size_t numLODs = 0, TextureLayout textureLayout = TextureLayout::Linear );
 
         /// <summary>
         /// Get all of the meshes of this model.
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Config.hpp"
+#include "Mesh.hpp"
+
+#include <Math/AABB.hpp>
+#include <Math/Camera3D.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace Graphics
+{
+/// <summary>
+/// Software occlusion culling.
+/// Large occluder meshes are rendered into a low-resolution depth buffer, and the bounding boxes
+/// of the other meshes are tested against this depth buffer before their vertices are processed.
+/// The depth buffer is conservative: a pixel is only written if it is completely covered by an occluder
+/// and it stores the farthest depth of the occluder in the pixel. A mesh that is (partially) visible is never culled.
+/// </summary>
+class SR_API OcclusionCuller
+{
+public:
+    /// <summary>
+    /// The default resolution of the occlusion depth buffer.
+    /// </summary>
+    static constexpr std::size_t DefaultWidth  = 320u;
+    static constexpr std::size_t DefaultHeight = 180u;
+
+    OcclusionCuller();
+
+    /// <summary>
+    /// Create an occlusion culler.
+    /// The resolution of the occlusion depth buffer does not need to match the resolution of the rasterizer,
+    /// but it should have roughly the same aspect ratio.
+    /// </summary>
+    /// <param name="width">The width of the occlusion depth buffer.</param>
+    /// <param name="height">The height of the occlusion depth buffer.</param>
+    OcclusionCuller( std::size_t width, std::size_t height );
+
+    /// <summary>
+    /// Remove all occluders from the occlusion depth buffer.
+    /// </summary>
+    void clear();
+
+    /// <summary>
+    /// Set the camera that is used to render the occluders and to test the bounding boxes.
+    /// This should be the same camera that is used by the rasterizer.
+    /// </summary>
+    /// <param name="camera">The camera.</param>
+    void setCamera( const Math::Camera* camera ) noexcept;
+
+    /// <summary>
+    /// Render an occluder into the occlusion depth buffer.
+    /// Occluders should be large meshes with few triangles (walls, floors, large props).
+    /// </summary>
+    /// <param name="mesh">The occluder mesh.</param>
+    /// <param name="modelMatrix">The model matrix of the occluder.</param>
+    void drawOccluder( const Mesh& mesh, const glm::mat4& modelMatrix );
+
+    /// <summary>
+    /// Test if a bounding box is completely hidden behind the occluders.
+    /// </summary>
+    /// <param name="aabb">The object-space bounding box.</param>
+    /// <param name="modelMatrix">The model matrix of the bounding box.</param>
+    /// <returns>`true` if the bounding box is occluded, `false` if it is (possibly) visible.</returns>
+    bool isOccluded( const Math::AABB& aabb, const glm::mat4& modelMatrix ) const noexcept;
+
+    /// <summary>
+    /// Get the occlusion depth buffer.
+    /// </summary>
+    /// <returns>The occlusion depth buffer.</returns>
+    const Buffer<float>& getDepthBuffer() const noexcept;
+
+private:
+    /// <summary>
+    /// Clip a clip-space triangle against the near plane and rasterize it.
+    /// </summary>
+    /// <param name="v">The clip-space vertices of the triangle.</param>
+    void drawTriangle( const glm::vec4 v[3] );
+
+    /// <summary>
+    /// Rasterize a screen-space triangle with conservative depth.
+    /// </summary>
+    /// <param name="p">The screen-space vertices of the triangle (x and y in pixels, z is the depth).</param>
+    void rasterizeTriangle( glm::vec3 p[3] );
+
+    /// <summary>
+    /// Transform a clip-space position to screen space.
+    /// </summary>
+    glm::vec3 toScreen( const glm::vec4& p ) const noexcept;
+
+    std::size_t width  = 0u;
+    std::size_t height = 0u;
+
+    const Math::Camera* camera = nullptr;
+
+    Buffer<float> depthBuffer;
+
+    // The clip-space positions of the occluder that is being rendered.
+    std::vector<glm::vec4> clipPositions;
+};
+}  // namespace Graphics
@@ -2,16 +2,28 @@
 
 #include "Buffer.hpp"
 #include "Config.hpp"
+#include "Fence.hpp"
+#include "Image.hpp"
 #include "Mesh.hpp"
+#include "Sampler.hpp"
 
 #include <Math/Camera3D.hpp>
 #include <Math/Plane.hpp>
+#include <Math/Rect.hpp>
 #include <Math/Viewport.hpp>
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vector>
 
 namespace Graphics
 {
+class OcclusionCuller;
+class ShadowMap;
+
 class SR_API Rasterizer
 {
 public:
@@ -25,6 +37,173 @@ public:
         Far
     };
 
+    /// <summary>
+    /// Determines how triangles are distributed to the rasterizer.
+    /// </summary>
+    enum class RasterMode
+    {
+        Immediate,  ///< Triangles are rasterized one at a time on the calling thread.
+        Tiled,      ///< Triangles are binned into screen tiles and the tiles are rasterized in parallel.
+    };
+
+    /// <summary>
+    /// Determines when fragments are shaded.
+    /// </summary>
+    enum class ShadingMode
+    {
+        Forward,           ///< Fragments are shaded when they pass the depth test.
+        VisibilityBuffer,  ///< Only the depth and the visibility (draw ID and triangle ID) are written. Each pixel is shaded once by resolve.
+    };
+
+    /// <summary>
+    /// The format of the depth buffer.
+    /// </summary>
+    enum class DepthFormat
+    {
+        Float32,  ///< 32-bit floating-point depth.
+        Unorm24,  ///< 24-bit normalized integer depth, stored in the low 24 bits of a 32-bit value.
+        Unorm16,  ///< 16-bit normalized integer depth. Halves the memory traffic of the depth test.
+    };
+
+    /// <summary>
+    /// The rasterization passes.
+    /// </summary>
+    enum class RasterPass
+    {
+        Shade,       ///< Depth test (less), write the depth, and shade the fragments.
+        Depth,       ///< Depth test (less) and write the depth (depth pre-pass). Only alpha tested triangles are textured.
+        ShadeEqual,  ///< Depth test (equal) and shade the fragments (after the depth pre-pass).
+    };
+
+    /// <summary>
+    /// The state of the fragment pipeline.
+    /// The rasterization kernels are compiled for every pipeline state, so the per-pixel work
+    /// only contains the depth test, attribute interpolation and texture sampling that the state requires.
+    /// The kernel is selected once per draw command.
+    /// </summary>
+    struct PipelineState
+    {
+        DepthFormat depthFormat      = DepthFormat::Float32;
+        RasterPass  pass             = RasterPass::Shade;
+        bool        alphaTest        = false;  ///< Discard fragments where the alpha texture is 0.
+        bool        diffuseTexture   = false;  ///< Sample the diffuse texture (with the rasterizer's sampler) instead of using the diffuse color.
+        bool        visibilityBuffer = false;  ///< Write the visibility ID instead of the color.
+        bool        multisample      = false;  ///< Test the coverage and depth of each sample of a pixel, and shade the pixel once.
+        bool        shadows          = false;  ///< Attenuate the color by the light that reaches the fragment (see setShadowMap).
+
+        /// <summary>
+        /// Check if the kernel reads the texture coordinates.
+        /// The texture coordinates (and 1/w) are only interpolated if they are read.
+        /// </summary>
+        /// <returns>`true` if the texture coordinates are interpolated.</returns>
+        constexpr bool texCoords() const noexcept
+        {
+            return alphaTest || ( pass != RasterPass::Depth && diffuseTexture && !visibilityBuffer );
+        }
+
+        /// <summary>
+        /// Check if the kernel reads the perspective-correct attributes (the texture coordinates or the light-space position).
+        /// </summary>
+        /// <returns>`true` if 1/w is interpolated.</returns>
+        constexpr bool perspective() const noexcept
+        {
+            return texCoords() || shadows;
+        }
+    };
+
+    /// <summary>
+    /// The size (in pixels) of a screen tile when using RasterMode::Tiled.
+    /// </summary>
+    static constexpr int TileSize = 64;
+
+    /// <summary>
+    /// The number of samples per pixel when multisampling is enabled.
+    /// </summary>
+    static constexpr int NumSamples = 4;
+
+    /// <summary>
+    /// Rendering statistics (similar to the pipeline statistics queries of a GPU).
+    /// The statistics are reset when the rasterizer is cleared, so they contain the statistics of the current frame.
+    /// The statistics are accumulated per draw command and per screen tile by the worker threads and summed afterwards,
+    /// so they are always enabled.
+    /// </summary>
+    struct Statistics
+    {
+        std::size_t meshesDrawn      = 0u;  // Meshes that are (at least partially) inside the view frustum and are not occluded.
+        std::size_t meshesCulled     = 0u;  // Meshes that are completely outside the view frustum.
+        std::size_t meshesInside     = 0u;  // Meshes that are completely inside the view frustum (and are not clipped).
+        std::size_t meshesOccluded   = 0u;  // Meshes that are hidden behind the occluders of the occlusion culler.
+        std::size_t meshesSimplified = 0u;  // Meshes that are drawn with a simplified level of detail (see Mesh::generateLODs).
+        std::size_t meshletsDrawn    = 0u;  // Meshlets of the drawn meshes that are (possibly) visible.
+        std::size_t meshletsCulled   = 0u;  // Meshlets of the drawn meshes that are outside the view frustum, backfacing, or occluded.
+        std::size_t verticesShaded   = 0u;  // Number of vertex shader invocations.
+        std::size_t fragmentsShaded  = 0u;  // Number of fragments that passed the depth test and were shaded.
+
+        std::size_t trianglesSubmitted  = 0u;  // Triangles of the visible meshlets.
+        std::size_t trianglesClipped    = 0u;  // Triangles that are sent to the clipper (the triangles of meshlets that cross the view frustum).
+        std::size_t trianglesCulled     = 0u;  // Triangles that are outside of the view frustum or back facing (or too small to cover a sample).
+        std::size_t trianglesRasterized = 0u;  // Triangles that are set up and rasterized (a clipped triangle can result in more than one triangle).
+
+        // Pixels, or samples with multisampling. The pixels of blocks that are rejected by the hierarchical depth test are not counted.
+        // With a depth pre-pass, the pixels are counted in both passes.
+        std::size_t pixelsTested  = 0u;  // Pixels that are covered by a triangle and are depth tested.
+        std::size_t pixelsPassed  = 0u;  // Pixels that passed the depth test.
+        std::size_t pixelsWritten = 0u;  // Pixels that passed the depth test and the alpha test and were written.
+
+        // The time (in milliseconds) spent in each stage of the pipeline.
+        // The draw commands are processed in parallel, so the time of the geometry stages (vertex, clip, and setup) is summed over the worker threads.
+        double vertexTime = 0.0;  // Transforming the vertices.
+        double clipTime   = 0.0;  // Culling the meshes and meshlets, and clipping the triangles.
+        double setupTime  = 0.0;  // Setting up the triangles.
+        double rasterTime = 0.0;  // Binning and rasterizing the triangles (with forward shading, this includes shading the fragments).
+        double shadeTime  = 0.0;  // Shading the visibility buffer and resolving the samples (see resolve).
+
+        Statistics& operator+=( const Statistics& rhs ) noexcept
+        {
+            meshesDrawn      += rhs.meshesDrawn;
+            meshesCulled     += rhs.meshesCulled;
+            meshesInside     += rhs.meshesInside;
+            meshesOccluded   += rhs.meshesOccluded;
+            meshesSimplified += rhs.meshesSimplified;
+            meshletsDrawn    += rhs.meshletsDrawn;
+            meshletsCulled   += rhs.meshletsCulled;
+            verticesShaded   += rhs.verticesShaded;
+            fragmentsShaded  += rhs.fragmentsShaded;
+
+            trianglesSubmitted  += rhs.trianglesSubmitted;
+            trianglesClipped    += rhs.trianglesClipped;
+            trianglesCulled     += rhs.trianglesCulled;
+            trianglesRasterized += rhs.trianglesRasterized;
+
+            pixelsTested  += rhs.pixelsTested;
+            pixelsPassed  += rhs.pixelsPassed;
+            pixelsWritten += rhs.pixelsWritten;
+
+            vertexTime += rhs.vertexTime;
+            clipTime   += rhs.clipTime;
+            setupTime  += rhs.setupTime;
+            rasterTime += rhs.rasterTime;
+            shadeTime  += rhs.shadeTime;
+            return *this;
+        }
+    };
+
+    /// <summary>
+    /// The maximum number of render targets (see setNumRenderTargets).
+    /// </summary>
+    static constexpr std::size_t MaxRenderTargets = 3u;
+
+    /// <summary>
+    /// A finished frame (see present).
+    /// </summary>
+    struct Frame
+    {
+        Image         image;        // The color render target.
+        Buffer<float> depthBuffer;  // The depth buffer, decoded to floating-point (see getDepthBuffer).
+        // Must be signaled by the consumer when it is done with the frame.
+        Fence fence;
+    };
+
     /// <summary>
     /// The input to the vertex shader.
     /// </summary>
@@ -40,14 +219,21 @@ public:
     /// </summary>
     struct VertexOutput
     {
-        glm::vec4 position;  // Position in clip-space.
-        glm::vec3 normal;    // Normal in world-space.
-        glm::vec2 uv;        // Texture coordinates.
+        glm::vec4 position;       // Position in clip-space.
+        glm::vec3 normal;         // Normal in world-space.
+        glm::vec2 uv;             // Texture coordinates.
+        glm::vec3 lightPosition;  // Position in light-space (only used with a shadow map).
     };
 
     Rasterizer();
 
-    Rasterizer( std::size_t width, std::size_t height );
+    /// <summary>
+    /// Create a rasterizer.
+    /// </summary>
+    /// <param name="width">The width of the render target.</param>
+    /// <param name="height">The height of the render target.</param>
+    /// <param name="depthFormat">The format of the depth buffer.</param>
+    Rasterizer( std::size_t width, std::size_t height, DepthFormat depthFormat = DepthFormat::Float32 );
 
     /// <summary>
     /// Clear the contents of the color and depth buffers.
@@ -63,20 +249,218 @@ public:
     /// <param name="modelMatrix"></param>
     void draw( const Mesh& mesh, const glm::mat4& modelMatrix );
 
+    /// <summary>
+    /// Draw multiple instances of a mesh.
+    /// The material of the mesh is only resolved once for all instances. Each instance is culled against
+    /// its own transformed bounds, the geometry of the instances is processed in parallel, and the
+    /// triangles of all instances are rasterized together (front to back).
+    /// </summary>
+    /// <param name="mesh">The mesh to draw.</param>
+    /// <param name="modelMatrices">The model matrix of each instance.</param>
+    void drawInstanced( const Mesh& mesh, std::span<const glm::mat4> modelMatrices );
+
+    /// <summary>
+    /// Record a draw command without drawing it.
+    /// The recorded draw commands are executed by the next call to flush.
+    /// This function is thread-safe: multiple threads can submit draw commands at the same time.
+    /// </summary>
+    /// <param name="mesh">The mesh to draw. The mesh must remain valid until the draw commands are flushed.</param>
+    /// <param name="modelMatrix">The model matrix of the mesh.</param>
+    void submit( const Mesh& mesh, const glm::mat4& modelMatrix );
+
+    /// <summary>
+    /// Execute all of the draw commands that were submitted since the last flush.
+    /// The draw commands are sorted front to back and their geometry is processed in parallel
+    /// before the triangles of all draw commands are rasterized together.
+    /// </summary>
+    void flush();
+
     void setCamera( const Math::Camera* camera ) noexcept;
     void setViewport( const Math::Viewport& viewport ) noexcept;
 
     /// <summary>
-    /// Get the color render target.
+    /// Set the occlusion culler that is used to skip meshes that are hidden behind occluders.
+    /// The occluders must be drawn into the occlusion culler before the meshes are drawn (or flushed).
+    /// </summary>
+    /// <param name="occlusionCuller">The occlusion culler, or null to disable occlusion culling.</param>
+    void setOcclusionCuller( const OcclusionCuller* occlusionCuller ) noexcept;
+
+    /// <summary>
+    /// Set the shadow map that is used to shadow the shaded fragments.
+    /// The shadow map must be updated and rendered before the meshes are drawn (or flushed).
+    /// </summary>
+    /// <param name="shadowMap">The shadow map, or null to disable shadows.</param>
+    void setShadowMap( const ShadowMap* shadowMap ) noexcept;
+
+    /// <summary>
+    /// Set the rasterization mode.
+    /// Both modes produce the same image. RasterMode::Tiled bins the triangles of a draw
+    /// into screen tiles and rasterizes the tiles in parallel (requires SR_USE_OPENMP).
+    /// </summary>
+    /// <param name="mode">The rasterization mode to use.</param>
+    void setRasterMode( RasterMode mode ) noexcept;
+
+    /// <summary>
+    /// Set the sampler that is used to sample the diffuse textures of the materials.
+    /// The level of detail is computed from the screen-space derivatives of the texture coordinates.
+    /// Alpha textures always use the nearest texel of the selected mip level.
+    /// </summary>
+    /// <param name="sampler">The sampler to use.</param>
+    void setSampler( const Sampler& sampler ) noexcept;
+
+    /// <summary>
+    /// Get the sampler that is used to sample the diffuse textures.
+    /// </summary>
+    /// <returns>The sampler.</returns>
+    const Sampler& getSampler() const noexcept;
+
+    /// <summary>
+    /// Get the current rasterization mode.
+    /// </summary>
+    /// <returns>The current rasterization mode.</returns>
+    RasterMode getRasterMode() const noexcept;
+
+    /// <summary>
+    /// Set the shading mode.
+    /// The shading mode should only be changed before the rasterizer is cleared.
+    /// </summary>
+    /// <param name="mode">The shading mode to use.</param>
+    void setShadingMode( ShadingMode mode );
+
+    /// <summary>
+    /// Get the current shading mode.
+    /// </summary>
+    /// <returns>The current shading mode.</returns>
+    ShadingMode getShadingMode() const noexcept;
+
+    /// <summary>
+    /// Enable or disable the depth pre-pass.
+    /// With a depth pre-pass, the triangles of a draw (or flush) are first rasterized with a depth-only kernel
+    /// and then shaded with an equal depth test, so only the visible fragments are shaded.
+    /// The depth pre-pass is most effective when all meshes are submitted and flushed together.
+    /// Where triangles have exactly the same depth, the last triangle is visible instead of the first.
+    /// </summary>
+    /// <param name="enabled">`true` to enable the depth pre-pass.</param>
+    void setDepthPrePass( bool enabled ) noexcept;
+
+    /// <summary>
+    /// Check if the depth pre-pass is enabled.
+    /// </summary>
+    /// <returns>`true` if the depth pre-pass is enabled.</returns>
+    bool getDepthPrePass() const noexcept;
+
+    /// <summary>
+    /// Enable or disable 4x multisampling.
+    /// With multisampling, the coverage and the depth test are evaluated for each of the NumSamples samples of a pixel,
+    /// but each pixel is only shaded once per triangle. The samples are averaged into the color render target by resolve.
+    /// Multisampling should only be enabled or disabled before the rasterizer is cleared.
+    /// </summary>
+    /// <param name="enabled">`true` to enable multisampling.</param>
+    void setMultisampling( bool enabled );
+
+    /// <summary>
+    /// Check if multisampling is enabled.
+    /// </summary>
+    /// <returns>`true` if multisampling is enabled.</returns>
+    bool getMultisampling() const noexcept;
+
+    /// <summary>
+    /// Set the largest acceptable (projected) simplification error of a mesh in pixels.
+    /// Meshes that have levels of detail (see Mesh::generateLODs) are drawn with the coarsest level
+    /// whose error is below this threshold for the size of the mesh on the screen.
+    /// A threshold of 0 always draws the meshes at full detail.
+    /// </summary>
+    /// <param name="pixels">The error threshold in pixels (default: 1).</param>
+    void setLODThreshold( float pixels ) noexcept;
+
+    /// <summary>
+    /// Get the largest acceptable simplification error of a mesh in pixels.
+    /// </summary>
+    /// <returns>The error threshold in pixels.</returns>
+    float getLODThreshold() const noexcept;
+
+    /// <summary>
+    /// Shade the pixels in the visibility buffer (with ShadingMode::VisibilityBuffer), and
+    /// average the samples of each pixel into the color render target (with multisampling).
+    /// This must be called after all meshes are drawn and before the color render target is used.
+    /// Pixels (or samples) that are not covered by a triangle keep the clear color.
+    /// </summary>
+    void resolve();
+
+    /// <summary>
+    /// Set the number of render targets (color and depth buffers) that the rasterizer cycles through.
+    /// With more than one render target, the consumer of a frame (see present) can use the frame on another
+    /// thread while the next frame is rendered into the next render target.
+    /// Waits until the consumers of all frames are done.
+    /// </summary>
+    /// <param name="count">The number of render targets in the range [1...MaxRenderTargets] (default: 1).</param>
+    void setNumRenderTargets( std::size_t count );
+
+    /// <summary>
+    /// Get the number of render targets that the rasterizer cycles through.
+    /// </summary>
+    /// <returns>The number of render targets.</returns>
+    std::size_t getNumRenderTargets() const noexcept;
+
+    /// <summary>
+    /// Finish the current frame and hand its render targets to a consumer (for example, to present, encode, or save the frame).
+    /// This must be called after resolve. The consumer must signal the fence of the frame when it is done with the frame.
+    /// The render targets belong to the frame until the next call to clear, which switches to the next render target
+    /// in the ring. If the consumer of an earlier frame still uses that render target, clear waits for its fence.
+    /// Until then, getImage and getDepthBuffer return the render targets of the presented frame, and nothing can be drawn.
+    /// The render targets that are owned by the rasterizer are handed to the frame without copying them. While a render target
+    /// is bound (see setRenderTarget and setDepthTarget), the contents of the bound render target are copied into the frame instead.
+    /// </summary>
+    /// <returns>The finished frame.</returns>
+    Frame& present();
+
+    /// <summary>
+    /// Bind an image that the rasterizer draws into instead of the color render target that it owns,
+    /// so the result can be used without copying it.
+    /// The image must be at least as large as the rasterizer. The viewport selects the part of the image that is drawn to:
+    /// clear and resolve only touch the pixels inside the viewport, so several rasterizers (or passes) can share an image.
+    /// </summary>
+    /// <param name="image">The color render target, or null to use the render target that is owned by the rasterizer.</param>
+    void setRenderTarget( Image* image );
+
+    /// <summary>
+    /// Bind a depth buffer that the rasterizer uses instead of the depth buffer that it owns.
+    /// Only a DepthFormat::Float32 depth buffer can be bound. The depth buffer must have the size of the rasterizer
+    /// (NumSamples times wider with multisampling, see setMultisampling). It is not resized: a depth buffer of a different size
+    /// is rejected, and a bound depth buffer is unbound if it no longer matches after the multisampling is changed.
+    /// The hierarchical depth is rebuilt from the contents of the depth buffer, so the depth buffer must be bound again
+    /// after it was modified outside of this rasterizer.
+    /// </summary>
+    /// <param name="depthBuffer">The depth buffer, or null to use the depth buffer that is owned by the rasterizer.</param>
+    void setDepthTarget( Buffer<float>* depthBuffer );
+
+    /// <summary>
+    /// Get the color render target (the bound image, see setRenderTarget).
+    /// Between present and the next clear, this is the image of the presented frame.
     /// </summary>
     /// <returns>The rasterizers render target.</returns>
     const Image& getImage() const noexcept;
 
+    /// <summary>
+    /// Get the format of the depth buffer.
+    /// </summary>
+    /// <returns>The depth format.</returns>
+    DepthFormat getDepthFormat() const noexcept;
+
     /// <summary>
     /// Get the depth buffer.
+    /// If the depth buffer uses a normalized integer format, the depth values are first decoded to floating-point.
+    /// With multisampling, the depth buffer contains the depth of the first sample of each pixel.
+    /// Between present and the next clear, this is the depth buffer of the presented frame (unless a depth target is bound).
     /// </summary>
     /// <returns>The depth buffer.</returns>
-    const Buffer<float>& getDepthBuffer() const noexcept;
+    const Buffer<float>& getDepthBuffer() const;
+
+    /// <summary>
+    /// Get the rendering statistics since the last time the rasterizer was cleared.
+    /// </summary>
+    /// <returns>The rendering statistics.</returns>
+    const Statistics& getStatistics() const noexcept;
 
 protected:
     /// <summary>
@@ -87,54 +471,480 @@ protected:
     /// <param name="modelViewMatrix">The model-view matrix to transform the vertex normal.</param>
     /// <param name="modelViewProjectionMatrix">The model-view-projection matrix to transform the vertex position.</param>
     /// <returns>The transformed vertex.</returns>
-    VertexOutput vertexShader( const VertexInput& in, const glm::mat4& modelMatrix, const glm::mat4& modelViewMatrix, const glm::mat4& modelViewProjectionMatrix );
+    VertexOutput vertexShader( const VertexInput& in, const glm::mat4& modelMatrix, const glm::mat4& modelViewMatrix, const glm::mat4& modelViewProjectionMatrix ) const;
+
+    /// <summary>
+    /// The number of vertices that are transformed together by the vertex stage.
+    /// </summary>
+    static constexpr int VertexBatchSize = 8;
+
+    /// <summary>
+    /// Transform a range of the vertices of a mesh.
+    /// The vertices are processed in batches of VertexBatchSize vertices and the
+    /// batches are distributed over the worker threads.
+    /// </summary>
+    /// <param name="mesh">The mesh to transform.</param>
+    /// <param name="modelMatrix">The model matrix.</param>
+    /// <param name="modelViewMatrix">The model-view matrix to transform the vertex normals.</param>
+    /// <param name="modelViewProjectionMatrix">The model-view-projection matrix to transform the vertex positions.</param>
+    /// <param name="vertices">The transformed vertices (indexed by the vertex index of the mesh).</param>
+    /// <param name="firstVertex">The first vertex to transform.</param>
+    /// <param name="lastVertex">One past the last vertex to transform.</param>
+    void transformVertices( const Mesh& mesh, const glm::mat4& modelMatrix, const glm::mat4& modelViewMatrix, const glm::mat4& modelViewProjectionMatrix, std::vector<VertexOutput>& vertices, int firstVertex, int lastVertex ) const;
+
+    /// <summary>
+    /// An edge equation in fixed-point screen space: F(x, y) = a * x + b * y + c,
+    /// where (x, y) is expressed in sub-pixel units. F(x, y) >= 0 for points inside the triangle.
+    /// The fill rule bias is already applied to c.
+    /// </summary>
+    struct Edge
+    {
+        std::int64_t a;
+        std::int64_t b;
+        std::int64_t c;
+        std::int64_t bias;  // 0 for top-left edges, -1 otherwise.
+    };
+
+    /// <summary>
+    /// A plane equation that interpolates an attribute linearly in screen space: A(x, y) = a + dx * x + dy * y,
+    /// where (x, y) is the offset (in pixels) from the center of the first pixel of the triangle's bounding box.
+    /// </summary>
+    struct Interpolant
+    {
+        float a;
+        float dx;
+        float dy;
+
+        float operator()( float x, float y ) const noexcept
+        {
+            return a + dx * x + dy * y;
+        }
+    };
+
+    /// <summary>
+    /// A triangle after clipping and setup.
+    /// </summary>
+    struct Triangle
+    {
+        Edge          e[3];        // Edge equations. e[i] is the edge opposite to vertex i.
+        Interpolant   z;           // Screen-space depth.
+        Interpolant   invW;        // 1/w (only set up if the triangle is textured or shadowed).
+        Interpolant   u, v;        // Texture coordinates divided by w (only set up if the triangle is textured).
+        Interpolant   lx, ly, lz;  // Light-space position divided by w (only set up if the triangle is shadowed).
+        float         minZ, maxZ;  // The depth range of the vertices.
+        int           minX, minY, maxX, maxY;  // Inclusive pixel bounding box of the triangle.
+        std::uint32_t drawId;      // Index of the draw command the triangle belongs to.
+        std::uint32_t triangleId;  // Index of the triangle in its draw command.
+    };
+
+    struct DrawCommand;
+
+    /// <summary>
+    /// A rasterization kernel that is compiled for a specific pipeline state.
+    /// </summary>
+    using KernelFunction = void ( Rasterizer::* )( const Triangle& tri, int minX, int minY, int maxX, int maxY, const DrawCommand& command, Statistics& stats );
+
+    /// <summary>
+    /// The block and pixel kernels of a pipeline state.
+    /// </summary>
+    struct Kernel
+    {
+        KernelFunction blocks = nullptr;
+        KernelFunction pixels = nullptr;
+    };
+
+    /// <summary>
+    /// A recorded draw command.
+    /// </summary>
+    struct DrawCommand
+    {
+        const Mesh*    mesh = nullptr;
+        glm::mat4      modelMatrix { 1.0f };
+        const Texture* alphaTexture   = nullptr;
+        const Texture* diffuseTexture = nullptr;
+        Color          diffuseColor;
+        float          depth   = 0.0f;   // View-space depth of the center of the mesh (used to sort the draw commands).
+        bool           shadows = false;  // Transform the vertices to light-space (see setShadowMap).
+        Kernel         depthKernel;      // The kernel of the depth pre-pass.
+        Kernel         shadeKernel;      // The kernel that shades the fragments.
+    };
+
+    /// <summary>
+    /// Get the rasterization kernels that are compiled for a pipeline state.
+    /// </summary>
+    /// <param name="state">The pipeline state.</param>
+    /// <returns>The kernels of the pipeline state.</returns>
+    static Kernel getKernel( const PipelineState& state ) noexcept;
+
+    /// <summary>
+    /// Create a draw command for a mesh.
+    /// </summary>
+    /// <param name="mesh">The mesh to draw.</param>
+    /// <param name="modelMatrix">The model matrix of the mesh.</param>
+    /// <returns>The draw command.</returns>
+    static DrawCommand makeDrawCommand( const Mesh& mesh, const glm::mat4& modelMatrix ) noexcept;
+
+    /// <summary>
+    /// Sort the draw commands in the commands buffer front to back.
+    /// </summary>
+    void sortDrawCommands();
+
+    /// <summary>
+    /// Execute the draw commands in the commands buffer.
+    /// </summary>
+    void execute();
+
+    /// <summary>
+    /// Compute the size of a mesh on the screen (the projected diameter of the bounding sphere of its AABB).
+    /// </summary>
+    /// <param name="aabb">The AABB of the mesh in object space.</param>
+    /// <param name="modelViewMatrix">The model-view matrix of the mesh.</param>
+    /// <returns>The size in pixels, or infinity if the camera is inside the bounding sphere (or there is no camera).</returns>
+    float getScreenSize( const Math::AABB& aabb, const glm::mat4& modelViewMatrix ) const noexcept;
+
+    /// <summary>
+    /// The geometry stage of a draw command: cull the mesh and its meshlets, transform the vertices
+    /// of the visible meshlets, and clip and setup the triangles.
+    /// This function does not modify the rasterizer, so multiple draw commands can be processed in parallel.
+    /// </summary>
+    /// <param name="command">The draw command to process.</param>
+    /// <param name="drawId">The index of the draw command.</param>
+    /// <param name="vertices">Storage for the transformed vertices.</param>
+    /// <param name="out">The triangles that should be rasterized.</param>
+    /// <param name="stats">The statistics of the draw command.</param>
+    void processDrawCommand( const DrawCommand& command, std::uint32_t drawId, std::vector<VertexOutput>& vertices, std::vector<Triangle>& out, Statistics& stats ) const;
+
+    /// <summary>
+    /// Rasterize the triangles of the executed draw commands (either immediately, or binned into screen tiles).
+    /// </summary>
+    void rasterizeTriangles();
+
+    /// <summary>
+    /// The number of fractional bits used for fixed-point vertex positions.
+    /// </summary>
+    static constexpr int SubPixelBits = 4;
+
+    /// <summary>
+    /// The number of sub-pixel steps per pixel.
+    /// </summary>
+    static constexpr int SubPixelSteps = 1 << SubPixelBits;
+
+    /// <summary>
+    /// The maximum absolute screen coordinate (in pixels) that can be represented in the
+    /// fixed-point edge equations without overflow.
+    /// </summary>
+    static constexpr float MaxScreenCoord = static_cast<float>( 1 << 25 );
+
+    /// <summary>
+    /// The size (in pixels) of the blocks that are used to rasterize a triangle.
+    /// Blocks that are completely outside of the triangle are skipped and blocks that
+    /// are completely inside of the triangle are filled without evaluating the edge equations.
+    /// </summary>
+    static constexpr int BlockSize = 8;
+
+    /// <summary>
+    /// The maximum edge equation coefficient (in sub-pixel units) for triangles that are
+    /// rasterized in blocks. For edges that are smaller than this, the edge equations
+    /// of a partially covered block fit in 32-bit integers.
+    /// Larger triangles fall back to rasterizing one pixel at a time.
+    /// </summary>
+    static constexpr std::int64_t MaxBlockEdgeCoefficient = 1 << 20;
+
+    /// <summary>
+    /// The size (in pixels) of the guard band around the viewport.
+    /// Triangles that are within the guard band are not clipped against the left, right, top, and bottom planes.
+    /// The guard band is small enough to keep the edges of clipped triangles within MaxBlockEdgeCoefficient.
+    /// </summary>
+    static constexpr float GuardBand = 8192.0f;
+
+    /// <summary>
+    /// The maximum number of vertices of a triangle after clipping against the 6 clipping planes.
+    /// </summary>
+    static constexpr int MaxClippedVertices = 9;
+
+    /// <summary>
+    /// Transform a clipped triangle to screen space, perform backface culling
+    /// and compute the fixed-point edge equations.
+    /// </summary>
+    /// <param name="in">The clip-space triangle.</param>
+    /// <param name="out">The screen-space triangle.</param>
+    /// <param name="texCoords">Set up the interpolation of the texture coordinates.</param>
+    /// <param name="shadows">Set up the interpolation of the light-space position.</param>
+    /// <returns>`true` if the triangle is front facing and should be rasterized, `false` if it was culled.</returns>
+    bool setupTriangle( const VertexOutput in[3], Triangle& out, bool texCoords, bool shadows ) const noexcept;
+
+    /// <summary>
+    /// Rasterize a single screen-space triangle.
+    /// Only the pixels inside the bounds are written.
+    /// </summary>
+    /// <param name="tri">The triangle to rasterize (see setupTriangle).</param>
+    /// <param name="bounds">The (inclusive) pixel bounds to rasterize. This is either the viewport, or a screen tile.</param>
+    /// <param name="kernel">The kernel of the rasterization pass.</param>
+    /// <param name="command">The draw command of the triangle.</param>
+    /// <param name="stats">The statistics of the rasterized fragments are added to these statistics.</param>
+    void rasterize( const Triangle& tri, const Math::AABB& bounds, const Kernel& kernel, const DrawCommand& command, Statistics& stats );
+
+    /// <summary>
+    /// Rasterize a triangle in blocks of BlockSize x BlockSize pixels.
+    /// </summary>
+    /// <param name="tri">The triangle to rasterize.</param>
+    /// <param name="minX">The first column to rasterize.</param>
+    /// <param name="minY">The first row to rasterize.</param>
+    /// <param name="maxX">The last column to rasterize.</param>
+    /// <param name="maxY">The last row to rasterize.</param>
+    /// <param name="command">The draw command of the triangle.</param>
+    /// <param name="stats">The statistics of the rasterized fragments are added to these statistics.</param>
+    template<PipelineState State>
+    void rasterizeBlocks( const Triangle& tri, int minX, int minY, int maxX, int maxY, const DrawCommand& command, Statistics& stats );
 
     /// <summary>
-    /// Rasterize a single triangle to the color buffer.
+    /// Rasterize a triangle one pixel at a time. This is used for triangles
+    /// that are too large to be rasterized in blocks.
     /// </summary>
     /// <param name="tri">The triangle to rasterize.</param>
-    /// <param name="viewportAABB">The AABB of the viewport.</param>
-    /// <param name="alphaTexture">Alpha texture (or null).</param>
-    /// <param name="diffuseTexture">Diffuse texture (or null).</param>
-    /// <param name="diffuseColor">Diffuse color.</param>
-    void rasterize( VertexOutput tri[3], const Math::AABB& viewportAABB, const Image* alphaTexture, const Image* diffuseTexture, const Color& diffuseColor );
+    /// <param name="minX">The first column to rasterize.</param>
+    /// <param name="minY">The first row to rasterize.</param>
+    /// <param name="maxX">The last column to rasterize.</param>
+    /// <param name="maxY">The last row to rasterize.</param>
+    /// <param name="command">The draw command of the triangle.</param>
+    /// <param name="stats">The statistics of the rasterized fragments are added to these statistics.</param>
+    template<PipelineState State>
+    void rasterizePixels( const Triangle& tri, int minX, int minY, int maxX, int maxY, const DrawCommand& command, Statistics& stats );
+
+    /// <summary>
+    /// The sample positions of a pixel (in sub-pixel units, relative to the center of the pixel).
+    /// This is the standard 4x sample pattern of Direct3D.
+    /// Source: https://learn.microsoft.com/en-us/windows/win32/api/d3d11/ne-d3d11-d3d11_standard_multisample_quality_levels
+    /// </summary>
+    static constexpr int SampleOffsets[NumSamples][2] = { { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 } };
+
+    /// <summary>
+    /// Rasterize a triangle with multisampling, in blocks of BlockSize x BlockSize pixels.
+    /// The coverage and the depth are tested for each sample. The pixel is shaded once (at the center of the pixel)
+    /// and the color is written to the samples that passed the depth test.
+    /// This kernel is used for all triangle sizes.
+    /// </summary>
+    /// <param name="tri">The triangle to rasterize.</param>
+    /// <param name="minX">The first column to rasterize.</param>
+    /// <param name="minY">The first row to rasterize.</param>
+    /// <param name="maxX">The last column to rasterize.</param>
+    /// <param name="maxY">The last row to rasterize.</param>
+    /// <param name="command">The draw command of the triangle.</param>
+    /// <param name="stats">The statistics of the rasterized fragments are added to these statistics.</param>
+    template<PipelineState State>
+    void rasterizeSamples( const Triangle& tri, int minX, int minY, int maxX, int maxY, const DrawCommand& command, Statistics& stats );
+
+    /// <summary>
+    /// The perspective correct texture coordinates of a fragment and their screen-space derivatives.
+    /// </summary>
+    struct TexCoords
+    {
+        glm::vec2 uv;
+        glm::vec2 ddx;  // The change of the texture coordinates for one pixel step in x.
+        glm::vec2 ddy;  // The change of the texture coordinates for one pixel step in y.
+    };
+
+    /// <summary>
+    /// Interpolate the texture coordinates of a triangle.
+    /// </summary>
+    /// <param name="tri">The triangle. The texture coordinates must be set up.</param>
+    /// <param name="x">The offset of the pixel from the first column of the triangle's bounding box.</param>
+    /// <param name="y">The offset of the pixel from the first row of the triangle's bounding box.</param>
+    /// <returns>The texture coordinates of the pixel.</returns>
+    static TexCoords interpolateTexCoords( const Triangle& tri, float x, float y ) noexcept;
+
+    /// <summary>
+    /// Attenuate the color of a fragment by the light that reaches it (see setShadowMap).
+    /// </summary>
+    /// <param name="color">The color of the fragment.</param>
+    /// <param name="tri">The triangle. The light-space position must be set up.</param>
+    /// <param name="x">The offset of the pixel from the first column of the triangle's bounding box.</param>
+    /// <param name="y">The offset of the pixel from the first row of the triangle's bounding box.</param>
+    /// <param name="w">The clip-space w of the fragment (the reciprocal of the interpolated 1/w).</param>
+    /// <returns>The shadowed color. The alpha is not changed.</returns>
+    Color applyShadow( const Color& color, const Triangle& tri, float x, float y, float w ) const noexcept;
+
+    /// <summary>
+    /// Depth test and shade a single pixel.
+    /// </summary>
+    /// <param name="tri">The triangle.</param>
+    /// <param name="x">The column of the pixel.</param>
+    /// <param name="y">The row of the pixel.</param>
+    /// <param name="command">The draw command of the triangle.</param>
+    /// <param name="pixelsWritten">Incremented if the fragment passed the alpha test and was written.</param>
+    /// <returns>`true` if the fragment passed the depth test and was shaded.</returns>
+    template<PipelineState State>
+    bool shadePixel( const Triangle& tri, int x, int y, const DrawCommand& command, std::size_t& pixelsWritten ) noexcept;
+
+    /// <summary>
+    /// Take the render targets of the current frame (after present), once its consumer is done with them.
+    /// </summary>
+    void acquireRenderTarget();
+
+    /// <summary>
+    /// Shade the pixels in the visibility buffer.
+    /// </summary>
+    void shadeVisibilityBuffer();
+
+    /// <summary>
+    /// Average the color samples of each pixel into the color render target (box filter).
+    /// </summary>
+    void resolveSamples();
+
+    /// <summary>
+    /// Recompute the hierarchical depth of a block from the depth buffer (including all samples of the pixels).
+    /// </summary>
+    /// <param name="blockX">The column of the block.</param>
+    /// <param name="blockY">The row of the block.</param>
+    template<DepthFormat Format>
+    void updateHiZ( int blockX, int blockY ) noexcept;
+
+    /// <summary>
+    /// Recompute the hierarchical depth of the blocks that overlap a rectangle.
+    /// </summary>
+    /// <param name="rect">The rectangle in pixels.</param>
+    void updateHiZ( const Math::RectI& rect ) noexcept;
+
+    /// <summary>
+    /// Get the pixels that are inside the viewport (clamped to the size of the rasterizer).
+    /// </summary>
+    /// <returns>The viewport rectangle in pixels.</returns>
+    Math::RectI getViewportRect() const noexcept;
+
+    /// <summary>
+    /// Get the color render target that is drawn to.
+    /// </summary>
+    /// <returns>The bound image, or the render target that is owned by the rasterizer.</returns>
+    Image& getColorTarget() noexcept;
+
+    /// <summary>
+    /// The value of a pixel in the visibility buffer that is not covered by a triangle.
+    /// </summary>
+    static constexpr std::uint64_t InvalidVisibilityId = ~std::uint64_t { 0 };
+
+    /// <summary>
+    /// Pack the draw ID and the triangle ID of a triangle into a visibility buffer value.
+    /// The draw ID is stored in the upper 32 bits and the triangle ID in the lower 32 bits.
+    /// </summary>
+    /// <param name="tri">The triangle.</param>
+    /// <returns>The visibility ID of the triangle.</returns>
+    std::uint64_t makeVisibilityId( const Triangle& tri ) const noexcept;
+
+    /// <summary>
+    /// Get the depth buffer that stores the depth values in the given format.
+    /// With multisampling, the samples of a pixel are stored next to each other.
+    /// </summary>
+    /// <returns>The depth buffer.</returns>
+    template<DepthFormat Format>
+    auto& getDepthTarget() noexcept;
 
     /// <summary>
     /// Compute the distance from the point to one of the clipping planes.
+    /// The left, right, top, and bottom planes are pushed out by the guard band.
     /// </summary>
-    /// <param name="p">The clipping plane.</param>
-    /// <param name="plane"></param>
-    /// <returns>The signed distance from p to the plane.</returns>
-    static float distance( const glm::vec4& p, Plane plane );
+    /// <param name="p">The clip-space point.</param>
+    /// <param name="plane">The clipping plane.</param>
+    /// <param name="guardBand">The size of the guard band in normalized device coordinates (1 for the view frustum).</param>
+    /// <returns>The signed distance from p to the plane. The distance is positive on the visible side of the plane.</returns>
+    static float distance( const glm::vec4& p, Plane plane, const glm::vec2& guardBand = glm::vec2 { 1.0f } );
 
     /// <summary>
-    /// Clip a triangle against a single clipping plane.
+    /// Clip a polygon against a single clipping plane.
     /// </summary>
     /// <param name="in">The input vertices.</param>
     /// <param name="n_in">The number of input vertices.</param>
-    /// <param name="out">The clipped triangles(s).</param>
-    /// <param name="plane">The plane to clip the triangle against.</param>
-    /// <returns>The number of resulting triangles.</returns>
-    static int clipTriangle( const VertexOutput* in, int n_in, VertexOutput* out, Plane plane );
+    /// <param name="out">The clipped polygon. Must have room for n_in + 1 vertices.</param>
+    /// <param name="plane">The plane to clip the polygon against.</param>
+    /// <param name="guardBand">The size of the guard band in normalized device coordinates.</param>
+    /// <returns>The number of vertices in the clipped polygon.</returns>
+    static int clipTriangle( const VertexOutput* in, int n_in, VertexOutput* out, Plane plane, const glm::vec2& guardBand );
 
     /// <summary>
-    /// Clip a triangle against the clipping planes.
+    /// The clip and cull stage.
+    /// Triangles that are completely outside one of the view frustum planes or
+    /// that are back facing are rejected. Triangles that exceed the guard band
+    /// or cross the near or far planes are clipped.
     /// </summary>
-    /// <param name="in">The triangle to be clipped.</param>
-    /// <param name="out">The clipped triangle(s).</param>
-    /// <returns>The number of resulting triangles.</returns>
-    static int clipTriangle( const VertexOutput* in, VertexOutput* out );
+    /// <param name="in">The clip-space triangle.</param>
+    /// <param name="out">The clipped polygon. Must have room for MaxClippedVertices vertices.</param>
+    /// <returns>The number of vertices in the clipped polygon (0 if the triangle was rejected).</returns>
+    int clipTriangle( const VertexOutput in[3], VertexOutput* out ) const noexcept;
 
 private:
     std::size_t width  = 0u;
     std::size_t height = 0u;
 
-    const Math::Camera* camera = nullptr;
+    const Math::Camera*    camera          = nullptr;
+    const OcclusionCuller* occlusionCuller = nullptr;
+    const ShadowMap*       shadowMap       = nullptr;
+
+    Image renderTarget;
+    // The color and depth targets that are drawn to instead of renderTarget and depthBuffer (see setRenderTarget and setDepthTarget).
+    Image*         boundColorTarget = nullptr;
+    Buffer<float>* boundDepthTarget = nullptr;
+    // The color samples of each pixel (only used with multisampling).
+    Buffer<Color> colorSamples;
 
-    Image         renderTarget;
-    Buffer<float> depthBuffer;
+    // Only the depth buffer that matches the depth format is used.
+    DepthFormat           depthFormat = DepthFormat::Float32;
+    Buffer<float>         depthBuffer;
+    Buffer<std::uint32_t> depthBuffer24;
+    Buffer<std::uint16_t> depthBuffer16;
+    // Floating-point copy of a normalized integer (or multisampled) depth buffer (see getDepthBuffer).
+    mutable Buffer<float> decodedDepthBuffer;
+
+    // The draw ID and triangle ID of the visible triangle in each pixel, or sample (only used with ShadingMode::VisibilityBuffer).
+    Buffer<std::uint64_t> visibilityBuffer;
+
+    // Hierarchical depth: the nearest and farthest depth values in each BlockSize x BlockSize block of the depth buffer.
+    Buffer<float> hiZMin;
+    Buffer<float> hiZMax;
 
     Math::Viewport viewport;
+    Sampler        sampler;
+    RasterMode     rasterMode    = RasterMode::Tiled;
+    ShadingMode    shadingMode   = ShadingMode::Forward;
+    bool           depthPrePass  = false;
+    bool           multisampling = false;
+    float          lodThreshold  = 1.0f;
+    Statistics     statistics;
+
+    // Number of screen tiles in each direction.
+    int numTilesX = 0;
+    int numTilesY = 0;
+
+    // Draw commands that were submitted since the last flush.
+    std::vector<DrawCommand> submittedCommands;
+    std::mutex               submitMutex;
+
+    // The draw commands that are being executed.
+    std::vector<DrawCommand> commands;
+    // The transformed vertices, triangles, and statistics of each executed draw command.
+    std::vector<std::vector<VertexOutput>> commandVertices;
+    std::vector<std::vector<Triangle>>     commandTriangles;
+    std::vector<Statistics>                commandStatistics;
+
+    // The triangles of all executed draw commands (after clipping and setup).
+    std::vector<Triangle> triangles;
+
+    // The draw commands and triangles of the frame that are referenced by the visibility buffer.
+    std::vector<DrawCommand>           frameCommands;
+    std::vector<std::vector<Triangle>> frameTriangles;
+    // The draw ID of the first draw command that is being executed.
+    std::uint32_t visibilityDrawOffset = 0u;
+    // The indices of the triangles that overlap each screen tile (in submission order).
+    std::vector<std::vector<std::uint32_t>> tileBins;
+    // The statistics of each screen tile.
+    std::vector<Statistics> tileStatistics;
+
+    // The frames that are handed to the consumer (see present). The render targets of the current frame
+    // are moved into renderTarget and depthBuffer while the frame is rendered (see acquireRenderTarget).
+    std::array<Frame, MaxRenderTargets> frames;
+    std::size_t                         numRenderTargets     = 1u;
+    std::size_t                         currentRenderTarget  = 0u;
+    bool                                renderTargetAcquired = true;
+    // The last presented frame, until the next clear (see getImage and getDepthBuffer).
+    const Frame* presentedFrame = nullptr;
 };
 
 inline Rasterizer::VertexOutput operator*( float lhs, const Rasterizer::VertexOutput& rhs )
@@ -142,7 +952,8 @@ inline Rasterizer::VertexOutput operator*( float lhs, const Rasterizer::VertexOu
     return {
         lhs * rhs.position,
         lhs * rhs.normal,
-        lhs * rhs.uv
+        lhs * rhs.uv,
+        lhs * rhs.lightPosition
     };
 }
 
@@ -152,6 +963,7 @@ inline Rasterizer::VertexOutput operator*( const Rasterizer::VertexOutput& lhs,
         lhs.position * rhs,
         lhs.normal * rhs,
         lhs.uv * rhs,
+        lhs.lightPosition * rhs
     };
 }
 
@@ -160,7 +972,8 @@ inline Rasterizer::VertexOutput operator+( const Rasterizer::VertexOutput& lhs,
     return {
         lhs.position + rhs.position,
         lhs.normal + rhs.normal,
-        lhs.uv + rhs.uv
+        lhs.uv + rhs.uv,
+        lhs.lightPosition + rhs.lightPosition
     };
 }
 
@@ -169,7 +982,8 @@ inline Rasterizer::VertexOutput operator-( const Rasterizer::VertexOutput& lhs,
     return {
         lhs.position - rhs.position,
         lhs.normal - rhs.normal,
-        lhs.uv - rhs.uv
+        lhs.uv - rhs.uv,
+        lhs.lightPosition - rhs.lightPosition
     };
 }
 
@@ -6,6 +6,7 @@
 #include "Material.hpp"
 #include "Model.hpp"
 #include "SpriteSheet.hpp"
+#include "Texture.hpp"
 
 #include <filesystem>
 #include <memory>
@@ -22,6 +23,16 @@ public:
     /// <returns>The loaded image.</returns>
     static std::shared_ptr<Image> loadImage( const std::filesystem::path& filePath );
 
+    /// <summary>
+    /// Load a texture from a file and generate its mip chain.
+    /// The image of the first mip level is shared with loadImage.
+    /// A file that is loaded with different layouts results in a separate texture for each layout.
+    /// </summary>
+    /// <param name="filePath">The path to the file to load.</param>
+    /// <param name="layout">(optional) The memory layout of the mip levels. Default: TextureLayout::Linear.</param>
+    /// <returns>The loaded texture, or null if the image could not be loaded.</returns>
+    static std::shared_ptr<Texture> loadTexture( const std::filesystem::path& filePath, TextureLayout layout = TextureLayout::Linear );
+
     /// <summary>
     /// Load a sprite sheet from a file.
     /// </summary>
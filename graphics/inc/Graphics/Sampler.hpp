@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Color.hpp"
+#include "Config.hpp"
+#include "Enums.hpp"
+#include "Texture.hpp"
+
+#include <glm/vec2.hpp>
+
+namespace Graphics
+{
+/// <summary>
+/// Texture filtering modes.
+/// </summary>
+enum class Filter
+{
+    Nearest,    ///< Nearest texel of the nearest mip level.
+    Bilinear,   ///< Bilinear interpolation of the 2x2 nearest texels of the nearest mip level.
+    Trilinear,  ///< Bilinear interpolation in the two nearest mip levels, blended by the fractional level of detail.
+};
+
+/// <summary>
+/// A sampler determines how a texture is filtered and addressed.
+/// The wrap address mode is applied to the texture coordinates, so the texels are addressed without an integer division.
+/// </summary>
+struct SR_API Sampler
+{
+    Filter      filter      = Filter::Trilinear;
+    AddressMode addressMode = AddressMode::Wrap;
+    float       lodBias     = 0.0f;  ///< Added to the level of detail before the mip level is selected.
+
+    /// <summary>
+    /// Compute the level of detail from the screen-space derivatives of the texture coordinates.
+    /// </summary>
+    /// <param name="texture">The texture to sample.</param>
+    /// <param name="ddx">The change of the normalized texture coordinates for one pixel step in x.</param>
+    /// <param name="ddy">The change of the normalized texture coordinates for one pixel step in y.</param>
+    /// <returns>The level of detail (including the LOD bias). 0 is the first mip level.</returns>
+    float getLOD( const Texture& texture, const glm::vec2& ddx, const glm::vec2& ddy ) const noexcept;
+
+    /// <summary>
+    /// Sample a texture.
+    /// </summary>
+    /// <param name="texture">The texture to sample.</param>
+    /// <param name="uv">The normalized texture coordinates.</param>
+    /// <param name="lod">The level of detail (see getLOD).</param>
+    /// <returns>The filtered color.</returns>
+    Color sample( const Texture& texture, const glm::vec2& uv, float lod ) const noexcept;
+
+    /// <summary>
+    /// Sample the nearest texel of a texture, regardless of the filter mode.
+    /// This is used for the alpha test.
+    /// </summary>
+    /// <param name="texture">The texture to sample.</param>
+    /// <param name="uv">The normalized texture coordinates.</param>
+    /// <param name="lod">The level of detail (see getLOD).</param>
+    /// <returns>The color of the nearest texel in the nearest mip level.</returns>
+    const Color& sampleNearest( const Texture& texture, const glm::vec2& uv, float lod ) const noexcept;
+};
+}  // namespace Graphics
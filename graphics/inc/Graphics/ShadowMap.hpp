@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Config.hpp"
+#include "Mesh.hpp"
+
+#include <Math/Camera3D.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace Graphics
+{
+/// <summary>
+/// Cascaded shadow maps for a directional light.
+/// The view frustum of the camera is split into depth ranges (cascades), and the shadow casters are rendered
+/// into a separate depth buffer for each cascade with an orthographic projection along the light direction.
+/// The cascades are rendered in parallel: each cascade is rendered by its own worker thread through a depth-only path.
+/// Source: Wolfgang Engel, "Cascaded Shadow Maps", ShaderX5, 2006.
+/// </summary>
+class SR_API ShadowMap
+{
+public:
+    /// <summary>
+    /// The maximum number of cascades.
+    /// </summary>
+    static constexpr std::size_t MaxCascades = 4u;
+
+    /// <summary>
+    /// The default resolution (width and height) of the depth buffer of a cascade.
+    /// </summary>
+    static constexpr std::size_t DefaultResolution = 1024u;
+
+    /// <summary>
+    /// A cascade of the shadow map.
+    /// </summary>
+    struct Cascade
+    {
+        // Transforms a world-space position to shadow map space: x and y in texels, z is the depth in the range [0...1].
+        glm::mat4 shadowMatrix { 1.0f };
+        // Transforms a light-space position (see getLightViewMatrix) to shadow map space.
+        // The light-space transform is orthographic, so it only scales and translates: p * scale + offset.
+        glm::vec3 scale { 1.0f };
+        glm::vec3 offset { 0.0f };
+        // The far view-space depth of the cascade.
+        float splitDepth = 0.0f;
+
+        Buffer<float> depthBuffer;
+    };
+
+    ShadowMap();
+
+    /// <summary>
+    /// Create a shadow map.
+    /// </summary>
+    /// <param name="resolution">The width and height of the depth buffer of each cascade.</param>
+    /// <param name="numCascades">The number of cascades (at most MaxCascades).</param>
+    explicit ShadowMap( std::size_t resolution, std::size_t numCascades = MaxCascades );
+
+    /// <summary>
+    /// Set the direction of the light (from the light towards the scene).
+    /// </summary>
+    /// <param name="direction">The light direction.</param>
+    void setLightDirection( const glm::vec3& direction ) noexcept;
+    const glm::vec3& getLightDirection() const noexcept;
+
+    /// <summary>
+    /// Set the view distance that is covered by the cascades.
+    /// Beyond this distance (or the far plane of the camera), nothing is in shadow.
+    /// </summary>
+    /// <param name="distance">The shadow distance.</param>
+    void setShadowDistance( float distance ) noexcept;
+    float getShadowDistance() const noexcept;
+
+    /// <summary>
+    /// Set how much of the light is blocked in the shadow.
+    /// </summary>
+    /// <param name="strength">The shadow strength in the range [0...1] (default: 0.6).</param>
+    void setShadowStrength( float strength ) noexcept;
+    float getShadowStrength() const noexcept;
+
+    /// <summary>
+    /// Fit the cascades to the view frustum of the camera.
+    /// This must be called before the shadow casters are rendered (and when the camera or the light moves).
+    /// </summary>
+    /// <param name="camera">The camera that is used to render the scene.</param>
+    void update( const Math::Camera& camera );
+
+    /// <summary>
+    /// Record a shadow caster. The shadow casters are rendered by the next call to render.
+    /// </summary>
+    /// <param name="mesh">The mesh that casts a shadow. The mesh must remain valid until the shadow map is rendered.</param>
+    /// <param name="modelMatrix">The model matrix of the mesh.</param>
+    void submit( const Mesh& mesh, const glm::mat4& modelMatrix );
+
+    /// <summary>
+    /// Clear the cascades and render the shadow casters that were submitted since the last call to render.
+    /// </summary>
+    void render();
+
+    /// <summary>
+    /// Get the fraction of the light that reaches a position.
+    /// The position is tested against the first (most detailed) cascade that contains it,
+    /// with a 2x2 percentage-closer filter.
+    /// </summary>
+    /// <param name="lightPosition">The position in light space (see getLightViewMatrix).</param>
+    /// <returns>1 if the position is lit, 1 - strength if the position is completely in shadow.</returns>
+    float getLight( const glm::vec3& lightPosition ) const noexcept;
+
+    /// <summary>
+    /// Get the transformation from world space to light space.
+    /// The light looks along the negative z-axis of light space.
+    /// </summary>
+    /// <returns>The light view matrix.</returns>
+    const glm::mat4& getLightViewMatrix() const noexcept;
+
+    std::size_t    getNumCascades() const noexcept;
+    const Cascade& getCascade( std::size_t i ) const noexcept;
+
+private:
+    /// <summary>
+    /// Render the shadow casters into the depth buffer of a cascade.
+    /// </summary>
+    void renderCascade( Cascade& cascade ) const;
+
+    struct Caster
+    {
+        const Mesh* mesh;
+        glm::mat4   modelMatrix;
+    };
+
+    std::size_t resolution = DefaultResolution;
+
+    glm::vec3 lightDirection { 0.0f, -1.0f, 0.0f };
+    glm::mat4 lightViewMatrix { 1.0f };
+
+    float shadowDistance = 0.0f;  // 0 means the far plane of the camera.
+    float shadowStrength = 0.6f;
+
+    std::vector<Cascade> cascades;
+    std::vector<Caster>  casters;
+};
+}  // namespace Graphics
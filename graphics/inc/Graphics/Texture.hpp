@@ -0,0 +1,150 @@
+#pragma once
+
+#include "Config.hpp"
+#include "Image.hpp"
+#include "aligned_unique_ptr.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace Graphics
+{
+/// <summary>
+/// The memory layout of the texels of a texture.
+/// </summary>
+enum class TextureLayout
+{
+    Linear,  ///< Row-major (the same layout as an Image).
+    Tiled,   ///< 4x4 texel tiles (one 64 byte cache line per tile). The tiles are stored row-major.
+};
+
+/// <summary>
+/// A texture that is sampled by the rasterizer.
+/// A texture stores the mip chain of an image: each mip level is half the size of the previous level,
+/// down to a single texel.
+/// The mip levels are converted to the layout of the texture once, when the texture is created.
+/// With the tiled layout, the 2x2 texels of a bilinear sample are usually in the same cache line and
+/// a step along the v axis of the texture does not skip a whole row of texels.
+/// </summary>
+class SR_API Texture final
+{
+public:
+    /// <summary>
+    /// The size (in texels) of a tile in the tiled layout.
+    /// </summary>
+    static constexpr uint32_t TileShift = 2u;
+    static constexpr uint32_t TileSize  = 1u << TileShift;
+
+    /// <summary>
+    /// A mip level of a texture, in the layout of the texture.
+    /// </summary>
+    struct MipLevel
+    {
+        const Color* texels    = nullptr;
+        uint32_t     width     = 0u;
+        uint32_t     height    = 0u;
+        uint32_t     tilesX    = 0u;  ///< The number of tiles in a row of tiles.
+        uint32_t     tileShift = 0u;  ///< log2 of the tile size (0 for the linear layout).
+
+        /// <summary>
+        /// Get the index of a texel in the mip level.
+        /// The linear layout uses tiles of 1x1 texels, so both layouts use the same (branchless) computation.
+        /// </summary>
+        /// <param name="x">The x-coordinate of the texel.</param>
+        /// <param name="y">The y-coordinate of the texel.</param>
+        /// <returns>The index of the texel.</returns>
+        std::size_t index( uint32_t x, uint32_t y ) const noexcept
+        {
+            assert( x < width && y < height );
+
+            const uint32_t    mask = ( 1u << tileShift ) - 1u;
+            const std::size_t tile = static_cast<std::size_t>( y >> tileShift ) * tilesX + ( x >> tileShift );
+
+            return ( tile << ( tileShift * 2u ) ) + ( ( y & mask ) << tileShift ) + ( x & mask );
+        }
+
+        const Color& operator()( uint32_t x, uint32_t y ) const noexcept
+        {
+            return texels[index( x, y )];
+        }
+    };
+
+    Texture();
+
+    /// <summary>
+    /// Create a texture from an image and generate its mip chain.
+    /// </summary>
+    /// <param name="image">The image of the first mip level.</param>
+    /// <param name="layout">The memory layout of the mip levels.</param>
+    explicit Texture( std::shared_ptr<Image> image, TextureLayout layout = TextureLayout::Linear );
+
+    /// <summary>
+    /// Check if this is a valid texture.
+    /// </summary>
+    explicit operator bool() const noexcept
+    {
+        return image && *image;
+    }
+
+    /// <summary>
+    /// Get the number of mip levels of the texture.
+    /// </summary>
+    /// <returns>The number of mip levels.</returns>
+    uint32_t getNumMipLevels() const noexcept
+    {
+        return static_cast<uint32_t>( mipLevels.size() );
+    }
+
+    /// <summary>
+    /// Get a mip level of the texture.
+    /// </summary>
+    /// <param name="level">The mip level. Level 0 is the image the texture was created from.</param>
+    /// <returns>The mip level.</returns>
+    const MipLevel& getMipLevel( uint32_t level ) const noexcept
+    {
+        assert( level < getNumMipLevels() );
+        return mipLevels[level];
+    }
+
+    /// <summary>
+    /// Get the memory layout of the mip levels.
+    /// </summary>
+    TextureLayout getLayout() const noexcept
+    {
+        return layout;
+    }
+
+    /// <summary>
+    /// Get the image the texture was created from.
+    /// </summary>
+    /// <returns>The (row-major) image of the first mip level.</returns>
+    const std::shared_ptr<Image>& getImage() const noexcept
+    {
+        return image;
+    }
+
+    uint32_t getWidth() const noexcept
+    {
+        return image ? image->getWidth() : 0u;
+    }
+
+    uint32_t getHeight() const noexcept
+    {
+        return image ? image->getHeight() : 0u;
+    }
+
+private:
+    /// <summary>
+    /// Generate the mip levels by averaging 2x2 texels of the previous level,
+    /// and store them in the layout of the texture.
+    /// </summary>
+    void generateMipMaps();
+
+    std::shared_ptr<Image> image;
+    TextureLayout          layout = TextureLayout::Linear;
+    // The texels of all mip levels.
+    aligned_unique_ptr<Color[]> texels;
+    // Mip levels 0 .. N.
+    std::vector<MipLevel> mipLevels;
+};
+}  // namespace Graphics
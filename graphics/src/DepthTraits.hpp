@@ -0,0 +1,149 @@
+#pragma once
+
+#include "SIMD.hpp"
+
+#include <Graphics/Rasterizer.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Graphics
+{
+/// <summary>
+/// Encoding and depth test functions for the depth formats.
+/// Depth values are compared in the format of the depth buffer, so the
+/// depth test never needs to decode the values in the depth buffer.
+/// </summary>
+template<Rasterizer::DepthFormat Format>
+struct DepthTraits;
+
+template<>
+struct DepthTraits<Rasterizer::DepthFormat::Float32>
+{
+    using Type = float;
+
+    // The maximum difference between a depth value and its decoded encoding.
+    static constexpr float Tolerance = 0.0f;
+
+    static Type encode( float z ) noexcept
+    {
+        return z;
+    }
+
+    static float decode( Type d ) noexcept
+    {
+        return d;
+    }
+
+#if SR_SSE2
+    // The functions below operate on the encoded depth values of 4 pixels.
+    static __m128 encode( __m128 z ) noexcept
+    {
+        return z;
+    }
+
+    static __m128 load( const Type* p ) noexcept
+    {
+        return _mm_loadu_ps( p );
+    }
+
+    static void store( Type* p, __m128 d ) noexcept
+    {
+        _mm_storeu_ps( p, d );
+    }
+
+    static __m128 less( __m128 a, __m128 b ) noexcept
+    {
+        return _mm_cmplt_ps( a, b );
+    }
+
+    static __m128 equal( __m128 a, __m128 b ) noexcept
+    {
+        return _mm_cmpeq_ps( a, b );
+    }
+#endif
+};
+
+/// <summary>
+/// Normalized integer depth with the given number of bits.
+/// </summary>
+template<typename T, int Bits>
+struct UnormDepthTraits
+{
+    using Type = T;
+
+    static constexpr float MaxValue = static_cast<float>( ( 1u << Bits ) - 1u );
+
+    // The maximum difference between a depth value and its decoded encoding (with some margin for rounding errors).
+    static constexpr float Tolerance = 2.0f / MaxValue;
+
+    // The depth is truncated instead of rounded, so a depth that is less than a decoded
+    // depth value also encodes to a smaller value. This keeps the hierarchical depth test
+    // (which uses decoded depth values) consistent with the depth test.
+    static Type encode( float z ) noexcept
+    {
+        return static_cast<Type>( std::clamp( z, 0.0f, 1.0f ) * MaxValue );
+    }
+
+    static float decode( Type d ) noexcept
+    {
+        return static_cast<float>( d ) / MaxValue;
+    }
+
+#if SR_SSE2
+    // The encoded depth values are stored as 32-bit integers in the lanes of the vector.
+    static __m128 encode( __m128 z ) noexcept
+    {
+        z = _mm_min_ps( _mm_max_ps( z, _mm_setzero_ps() ), _mm_set1_ps( 1.0f ) );
+        return _mm_castsi128_ps( _mm_cvttps_epi32( _mm_mul_ps( z, _mm_set1_ps( MaxValue ) ) ) );
+    }
+
+    // The encoded values are less than 2^31, so a signed comparison can be used.
+    static __m128 less( __m128 a, __m128 b ) noexcept
+    {
+        return _mm_castsi128_ps( _mm_cmplt_epi32( _mm_castps_si128( a ), _mm_castps_si128( b ) ) );
+    }
+
+    static __m128 equal( __m128 a, __m128 b ) noexcept
+    {
+        return _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_castps_si128( a ), _mm_castps_si128( b ) ) );
+    }
+#endif
+};
+
+template<>
+struct DepthTraits<Rasterizer::DepthFormat::Unorm24> : UnormDepthTraits<std::uint32_t, 24>
+{
+#if SR_SSE2
+    static __m128 load( const Type* p ) noexcept
+    {
+        return _mm_castsi128_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) ) );
+    }
+
+    static void store( Type* p, __m128 d ) noexcept
+    {
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( p ), _mm_castps_si128( d ) );
+    }
+#endif
+};
+
+template<>
+struct DepthTraits<Rasterizer::DepthFormat::Unorm16> : UnormDepthTraits<std::uint16_t, 16>
+{
+#if SR_SSE2
+    static __m128 load( const Type* p ) noexcept
+    {
+        const __m128i d = _mm_loadl_epi64( reinterpret_cast<const __m128i*>( p ) );
+        return _mm_castsi128_ps( _mm_unpacklo_epi16( d, _mm_setzero_si128() ) );
+    }
+
+    static void store( Type* p, __m128 d ) noexcept
+    {
+        // SSE2 only has a signed saturating pack, so sign extend the low 16 bits first to pack them unchanged.
+        __m128i i = _mm_castps_si128( d );
+        i         = _mm_srai_epi32( _mm_slli_epi32( i, 16 ), 16 );
+        _mm_storel_epi64( reinterpret_cast<__m128i*>( p ), _mm_packs_epi32( i, i ) );
+    }
+#endif
+};
+}  // namespace Graphics
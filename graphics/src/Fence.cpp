@@ -0,0 +1,30 @@
+#include <Graphics/Fence.hpp>
+
+using namespace Graphics;
+
+Fence::Fence( bool signaled ) noexcept
+: signaled { signaled }
+{}
+
+void Fence::signal() noexcept
+{
+    signaled.store( true, std::memory_order_release );
+    signaled.notify_all();
+}
+
+void Fence::reset() noexcept
+{
+    signaled.store( false, std::memory_order_relaxed );
+}
+
+bool Fence::isSignaled() const noexcept
+{
+    return signaled.load( std::memory_order_acquire );
+}
+
+void Fence::wait() const noexcept
+{
+    // Writes made before the fence was signaled are visible after the fence is acquired.
+    while ( !signaled.load( std::memory_order_acquire ) )
+        signaled.wait( false, std::memory_order_acquire );
+}
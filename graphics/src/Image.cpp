@@ -670,8 +670,9 @@ const Color& Image::sample( int u, int v, AddressMode addressMode ) const noexce
     {
     case AddressMode::Wrap:
     {
-        u = fast_mod( u, w );
-        v = fast_mod( v, h );
+        // Power-of-two sizes wrap with a bitmask instead of a division.
+        u = ( w & ( w - 1 ) ) == 0 ? u & ( w - 1 ) : fast_mod( u, w );
+        v = ( h & ( h - 1 ) ) == 0 ? v & ( h - 1 ) : fast_mod( v, h );
     }
     break;
     case AddressMode::Mirror:
@@ -8,8 +8,8 @@ Material::Material(
     const Color&           ambientColor,
     const Color&           emissiveColor,
     float                  specularPower,
-    std::shared_ptr<Image> diffuseTexture,
-    std::shared_ptr<Image> alphaTexture,
+    std::shared_ptr<Texture> diffuseTexture,
+    std::shared_ptr<Texture> alphaTexture,
     std::shared_ptr<Image> specularTexture,
     std::shared_ptr<Image> normalTexture,
     std::shared_ptr<Image> ambientTexture,
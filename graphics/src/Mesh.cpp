@@ -1,5 +1,10 @@
+#include "MeshSimplifier.hpp"
+#include "MeshletBuilder.hpp"
+
 #include <Graphics/Mesh.hpp>
 
+#include <glm/geometric.hpp>
+
 using namespace Graphics;
 
 Mesh::Mesh( std::span<const Vertex3D> vertices, std::span<int> indices, std::shared_ptr<Material> material )
@@ -25,6 +30,52 @@ Mesh::Mesh( std::span<const Vertex3D> vertices, std::span<int> indices, std::sha
         texCoords.emplace_back( vert.texCoord );
         colors.emplace_back( vert.color );
     }
+
+    if ( indexBuffer.empty() )
+        return;
+
+    meshlets = buildMeshlets( positions, indexBuffer );
+
+    // Reorder the vertices in the order they are first used by the meshlets,
+    // so the vertices of a meshlet are (mostly) close together in the vertex buffer.
+    std::vector<int> remap( positions.size(), -1 );
+    std::vector<int> order;
+    order.reserve( positions.size() );
+
+    for ( int& index: indexBuffer )
+    {
+        if ( remap[index] < 0 )
+        {
+            remap[index] = static_cast<int>( order.size() );
+            order.push_back( index );
+        }
+        index = remap[index];
+    }
+
+    // Keep the vertices that are not used by any triangle.
+    for ( std::size_t i = 0; i < remap.size(); ++i )
+    {
+        if ( remap[i] < 0 )
+            order.push_back( static_cast<int>( i ) );
+    }
+
+    const auto reorder = [&order]( auto& attribute ) {
+        std::remove_reference_t<decltype( attribute )> reordered;
+        reordered.reserve( order.size() );
+
+        for ( int i: order )
+            reordered.push_back( attribute[i] );
+
+        attribute = std::move( reordered );
+    };
+
+    reorder( positions );
+    reorder( normals );
+    reorder( tangents );
+    reorder( bitangents );
+    reorder( texCoords );
+    reorder( colors );
+
 }
 
 Mesh::Mesh()                                                     = default;
@@ -82,9 +133,82 @@ const std::shared_ptr<Material>& Mesh::getMaterial() const noexcept
 void Mesh::setMaterial( std::shared_ptr<Material> _material )
 {
     material = std::move( _material );
+
+    for ( auto& lod: lods )
+        lod.mesh->setMaterial( material );
 }
 
 const Math::AABB& Mesh::getAABB() const noexcept
 {
     return aabb;
 }
+
+void Mesh::generateLODs( std::size_t numLODs, float reduction )
+{
+    lods.clear();
+
+    if ( !hasIndices() )
+        return;
+
+    const float size  = glm::length( aabb.size() );
+    float       error = 0.0f;
+
+    std::vector<int> indices = indexBuffer;
+    for ( std::size_t i = 0; i < numLODs; ++i )
+    {
+        const std::size_t targetIndexCount = static_cast<std::size_t>( static_cast<float>( indices.size() / 3 ) * reduction ) * 3;
+
+        float            lodError;
+        std::vector<int> simplified = simplifyMesh( positions, indices, targetIndexCount, lodError );
+
+        // Stop if the mesh can't be simplified (by at least half of the requested reduction).
+        if ( simplified.empty() || simplified.size() > indices.size() - ( indices.size() - targetIndexCount ) / 2 )
+            break;
+
+        // Each level is simplified from the previous level, so the errors add up.
+        error += lodError;
+        indices = std::move( simplified );
+
+        // Only copy the vertices that are used by this level.
+        std::vector<int>      remap( positions.size(), -1 );
+        std::vector<Vertex3D> vertices;
+        std::vector<int>      lodIndices;
+        lodIndices.reserve( indices.size() );
+
+        for ( int index: indices )
+        {
+            if ( remap[index] < 0 )
+            {
+                remap[index] = static_cast<int>( vertices.size() );
+                vertices.emplace_back( positions[index], normals[index], tangents[index], bitangents[index], texCoords[index], colors[index] );
+            }
+            lodIndices.push_back( remap[index] );
+        }
+
+        lods.push_back( { std::make_shared<Mesh>( vertices, lodIndices, material ), size > 0.0f ? error / size : 0.0f } );
+    }
+}
+
+const std::vector<Mesh::Meshlet>& Mesh::getMeshlets() const noexcept
+{
+    return meshlets;
+}
+
+const std::vector<Mesh::LOD>& Mesh::getLODs() const noexcept
+{
+    return lods;
+}
+
+const Mesh& Mesh::selectLOD( float screenSize, float threshold ) const noexcept
+{
+    const Mesh* mesh = this;
+    for ( const auto& lod: lods )
+    {
+        if ( lod.error * screenSize > threshold )
+            break;
+
+        mesh = lod.mesh.get();
+    }
+
+    return *mesh;
+}
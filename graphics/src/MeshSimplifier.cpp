@@ -0,0 +1,379 @@
+#include "MeshSimplifier.hpp"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+using namespace Graphics;
+
+namespace
+{
+/// <summary>
+/// A quadric measures the weighted sum of the squared distances from a point to a set of planes.
+/// Only the upper triangle of the symmetric 4x4 matrix is stored.
+/// The sum of the weights is stored as well, so the error can be normalized to a squared distance.
+/// </summary>
+struct Quadric
+{
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+    double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+    double a22 = 0.0, a23 = 0.0;
+    double a33 = 0.0;
+
+    // The sum of the weights of the planes.
+    double weight = 0.0;
+
+    /// <summary>
+    /// Create the quadric of a plane (n.p + d = 0).
+    /// </summary>
+    static Quadric fromPlane( const glm::dvec3& n, double d, double weight ) noexcept
+    {
+        Quadric q;
+        q.a00 = weight * n.x * n.x;
+        q.a01 = weight * n.x * n.y;
+        q.a02 = weight * n.x * n.z;
+        q.a03 = weight * n.x * d;
+        q.a11 = weight * n.y * n.y;
+        q.a12 = weight * n.y * n.z;
+        q.a13 = weight * n.y * d;
+        q.a22 = weight * n.z * n.z;
+        q.a23 = weight * n.z * d;
+        q.a33 = weight * d * d;
+
+        q.weight = weight;
+
+        return q;
+    }
+
+    Quadric& operator+=( const Quadric& rhs ) noexcept
+    {
+        a00 += rhs.a00;
+        a01 += rhs.a01;
+        a02 += rhs.a02;
+        a03 += rhs.a03;
+        a11 += rhs.a11;
+        a12 += rhs.a12;
+        a13 += rhs.a13;
+        a22 += rhs.a22;
+        a23 += rhs.a23;
+        a33 += rhs.a33;
+
+        weight += rhs.weight;
+
+        return *this;
+    }
+
+    Quadric operator+( const Quadric& rhs ) const noexcept
+    {
+        Quadric q = *this;
+        return q += rhs;
+    }
+
+    /// <summary>
+    /// Evaluate the quadric error (p^T Q p) of a point, divided by the sum of the weights.
+    /// The area weights scale with the mesh, so without the division the error would not be a (squared) distance.
+    /// </summary>
+    double error( const glm::vec3& p ) const noexcept
+    {
+        const double x = p.x;
+        const double y = p.y;
+        const double z = p.z;
+
+        const double e = a00 * x * x + a11 * y * y + a22 * z * z + a33
+                         + 2.0 * ( a01 * x * y + a02 * x * z + a12 * y * z + a03 * x + a13 * y + a23 * z );
+
+        // The error can't be negative, except for rounding errors.
+        return weight > 0.0 ? std::max( e, 0.0 ) / weight : 0.0;
+    }
+};
+
+/// <summary>
+/// A half-edge collapse: vertex `from` is moved onto vertex `to`.
+/// </summary>
+struct Collapse
+{
+    int    from;
+    int    to;
+    double cost;
+};
+
+inline std::uint64_t edgeKey( int a, int b ) noexcept
+{
+    if ( a > b )
+        std::swap( a, b );
+
+    return static_cast<std::uint64_t>( a ) << 32 | static_cast<std::uint32_t>( b );
+}
+
+/// <summary>
+/// Check if two corners of a triangle are at the same position (see remap in simplifyMesh).
+/// </summary>
+inline bool isDegenerate( const int* tri, std::span<const int> remap ) noexcept
+{
+    return remap[tri[0]] == remap[tri[1]] || remap[tri[1]] == remap[tri[2]] || remap[tri[2]] == remap[tri[0]];
+}
+}  // namespace
+
+std::vector<int> Graphics::simplifyMesh( std::span<const glm::vec3> positions, std::span<const int> indices, std::size_t targetIndexCount, float& error )
+{
+    const std::size_t numVertices = positions.size();
+
+    std::vector<int> result( indices.begin(), indices.end() );
+    error = 0.0f;
+
+    if ( result.size() <= targetIndexCount )
+        return result;
+
+    // Vertices with the same position (on attribute seams, for example hard normals or texture seams) are welded into
+    // a single position vertex (the first of the vertices) for the topology and the quadrics.
+    // The vertices of a position vertex are moved together, so the seams don't open cracks (see findTargets).
+    std::vector<int> remap( numVertices );
+    {
+        std::vector<int> order( numVertices );
+        std::iota( order.begin(), order.end(), 0 );
+        std::sort( order.begin(), order.end(), [&positions]( int lhs, int rhs ) {
+            const glm::vec3& a = positions[lhs];
+            const glm::vec3& b = positions[rhs];
+            return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+        } );
+
+        for ( std::size_t i = 0; i < order.size(); ++i )
+            remap[order[i]] = i > 0 && positions[order[i]] == positions[order[i - 1]] ? remap[order[i - 1]] : order[i];
+    }
+
+    // Position vertices that are not moved by a collapse.
+    std::vector<bool> locked( numVertices, false );
+
+    // Lock the vertices on the border of the mesh (and on non-manifold edges).
+    // Interior edges are used by exactly two triangles.
+    {
+        std::vector<std::uint64_t> edges;
+        edges.reserve( result.size() );
+
+        for ( std::size_t i = 0; i < result.size(); i += 3 )
+        {
+            for ( std::size_t k = 0; k < 3; ++k )
+                edges.push_back( edgeKey( remap[result[i + k]], remap[result[i + ( k + 1 ) % 3]] ) );
+        }
+
+        std::sort( edges.begin(), edges.end() );
+
+        for ( std::size_t i = 0; i < edges.size(); )
+        {
+            std::size_t j = i + 1;
+            while ( j < edges.size() && edges[j] == edges[i] )
+                ++j;
+
+            if ( j - i != 2 )
+            {
+                locked[edges[i] >> 32]          = true;
+                locked[edges[i] & 0xffffffffu] = true;
+            }
+
+            i = j;
+        }
+    }
+
+    // The quadric of a position vertex is the sum of the (area weighted) planes of the triangles around the vertex.
+    std::vector<Quadric> quadrics( numVertices );
+    for ( std::size_t i = 0; i < result.size(); i += 3 )
+    {
+        const glm::dvec3 p0 = positions[result[i + 0]];
+        const glm::dvec3 p1 = positions[result[i + 1]];
+        const glm::dvec3 p2 = positions[result[i + 2]];
+
+        glm::dvec3   n    = glm::cross( p1 - p0, p2 - p0 );
+        const double area = glm::length( n );
+        if ( area == 0.0 )
+            continue;
+
+        n /= area;
+
+        const Quadric q = Quadric::fromPlane( n, -glm::dot( n, p0 ), area * 0.5 );
+        for ( std::size_t k = 0; k < 3; ++k )
+            quadrics[remap[result[i + k]]] += q;
+    }
+
+    // Check if moving a position vertex flips (or collapses) one of the remaining triangles around it.
+    const auto flips = [&positions, &result, &remap]( std::span<const int> triangles, int from, int to ) {
+        for ( int t: triangles )
+        {
+            const int* tri = &result[static_cast<std::size_t>( t ) * 3];
+
+            // Triangles that contain both vertices are removed by the collapse.
+            if ( isDegenerate( tri, remap ) || remap[tri[0]] == to || remap[tri[1]] == to || remap[tri[2]] == to )
+                continue;
+
+            glm::vec3 p[3], q[3];
+            for ( int k = 0; k < 3; ++k )
+            {
+                p[k] = positions[tri[k]];
+                q[k] = remap[tri[k]] == from ? positions[to] : p[k];
+            }
+
+            const glm::vec3 n0 = glm::cross( p[1] - p[0], p[2] - p[0] );
+            const glm::vec3 n1 = glm::cross( q[1] - q[0], q[2] - q[0] );
+
+            if ( glm::dot( n0, n1 ) <= 1e-2f * glm::length( n0 ) * glm::length( n1 ) )
+                return true;
+        }
+
+        return false;
+    };
+
+    // Find the vertex of position vertex `to` that each vertex of position vertex `from` is moved onto: a vertex in one of
+    // the triangles around the vertex, so each vertex keeps the attributes of its side of a seam.
+    // If a vertex of `from` doesn't share a triangle with `to`, the edge doesn't run along the seam and can't be collapsed.
+    std::vector<std::pair<int, int>> targets;
+
+    const auto findTargets = [&result, &remap, &targets]( std::span<const int> triangles, int from, int to ) {
+        targets.clear();
+        for ( int t: triangles )
+        {
+            const int* tri = &result[static_cast<std::size_t>( t ) * 3];
+            if ( isDegenerate( tri, remap ) )
+                continue;
+
+            int source = -1;
+            int target = -1;
+            for ( int k = 0; k < 3; ++k )
+            {
+                if ( remap[tri[k]] == from )
+                    source = tri[k];
+                else if ( remap[tri[k]] == to )
+                    target = tri[k];
+            }
+
+            auto iter = std::find_if( targets.begin(), targets.end(), [source]( const auto& entry ) { return entry.first == source; } );
+            if ( iter == targets.end() )
+                targets.emplace_back( source, target );
+            else if ( iter->second < 0 )
+                iter->second = target;
+        }
+
+        return std::none_of( targets.begin(), targets.end(), []( const auto& entry ) { return entry.second < 0; } );
+    };
+
+    std::vector<int>      triangleOffsets;
+    std::vector<int>      vertexTriangles;
+    std::vector<Collapse> collapses;
+    std::vector<bool>     collapsed;
+
+    double maxCost = 0.0;
+
+    // Collapse the cheapest edges in passes. Each position vertex is collapsed at most once per pass,
+    // so the costs and the adjacency only need to be computed at the start of a pass.
+    while ( result.size() > targetIndexCount )
+    {
+        // The triangles around each position vertex.
+        triangleOffsets.assign( numVertices + 1, 0 );
+        for ( int i: result )
+            ++triangleOffsets[remap[i] + 1];
+
+        std::partial_sum( triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin() );
+
+        vertexTriangles.resize( result.size() );
+        std::vector<int> fill( triangleOffsets.begin(), triangleOffsets.end() - 1 );
+        for ( std::size_t i = 0; i < result.size(); ++i )
+            vertexTriangles[fill[remap[result[i]]]++] = static_cast<int>( i / 3 );
+
+        const auto trianglesAround = [&]( int v ) {
+            return std::span<const int> { vertexTriangles.data() + triangleOffsets[v], vertexTriangles.data() + triangleOffsets[v + 1] };
+        };
+
+        // Find the cheapest collapse of each edge.
+        // Interior edges are visited twice (once in each direction), so only the edges with a < b are used.
+        collapses.clear();
+        for ( std::size_t i = 0; i < result.size(); i += 3 )
+        {
+            for ( std::size_t k = 0; k < 3; ++k )
+            {
+                const int a = remap[result[i + k]];
+                const int b = remap[result[i + ( k + 1 ) % 3]];
+                if ( a >= b )
+                    continue;
+
+                const Quadric q = quadrics[a] + quadrics[b];
+
+                Collapse c { -1, -1, std::numeric_limits<double>::max() };
+                if ( !locked[a] && findTargets( trianglesAround( a ), a, b ) )
+                    c = { a, b, q.error( positions[b] ) };
+                if ( !locked[b] && q.error( positions[a] ) < c.cost && findTargets( trianglesAround( b ), b, a ) )
+                    c = { b, a, q.error( positions[a] ) };
+
+                if ( c.from >= 0 )
+                    collapses.push_back( c );
+            }
+        }
+
+        std::sort( collapses.begin(), collapses.end(), []( const Collapse& lhs, const Collapse& rhs ) {
+            return lhs.cost < rhs.cost;
+        } );
+
+        collapsed.assign( numVertices, false );
+
+        const std::size_t trianglesToRemove = ( result.size() - targetIndexCount ) / 3;
+        std::size_t       trianglesRemoved  = 0;
+
+        for ( const Collapse& c: collapses )
+        {
+            if ( trianglesRemoved >= trianglesToRemove )
+                break;
+
+            if ( collapsed[c.from] || collapsed[c.to] )
+                continue;
+
+            const std::span<const int> triangles = trianglesAround( c.from );
+            if ( flips( triangles, c.from, c.to ) || !findTargets( triangles, c.from, c.to ) )
+                continue;
+
+            for ( int t: triangles )
+            {
+                int* tri = &result[static_cast<std::size_t>( t ) * 3];
+
+                const bool degenerate = isDegenerate( tri, remap );
+                for ( int k = 0; k < 3; ++k )
+                {
+                    if ( remap[tri[k]] != c.from )
+                        continue;
+
+                    const int source = tri[k];
+                    tri[k]           = std::find_if( targets.begin(), targets.end(), [source]( const auto& entry ) { return entry.first == source; } )->second;
+                }
+
+                if ( !degenerate && isDegenerate( tri, remap ) )
+                    ++trianglesRemoved;
+            }
+
+            quadrics[c.to] += quadrics[c.from];
+            collapsed[c.from] = collapsed[c.to] = true;
+            maxCost                             = std::max( maxCost, c.cost );
+        }
+
+    // Stop if no edge could be collapsed.
+        if ( trianglesRemoved == 0 )
+            break;
+
+        // Remove the degenerate triangles.
+        std::size_t n = 0;
+        for ( std::size_t i = 0; i < result.size(); i += 3 )
+        {
+            if ( isDegenerate( &result[i], remap ) )
+                continue;
+
+            for ( std::size_t k = 0; k < 3; ++k )
+                result[n++] = result[i + k];
+        }
+        result.resize( n );
+    }
+
+    // The quadric error is a weighted mean of squared distances.
+    error = static_cast<float>( std::sqrt( maxCost ) );
+
+    return result;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace Graphics
+{
+/// <summary>
+/// Simplify an indexed triangle mesh with quadric error metrics.
+/// Edges are collapsed onto one of their vertices (half-edge collapse), so the simplified
+/// mesh only references vertices of the original mesh and the vertex attributes don't need to be interpolated.
+/// Vertices on the border of the mesh are not moved. Vertices with the same position (on attribute seams) are moved
+/// together, and only along the seam, so the simplified mesh doesn't open cracks and each side of a seam keeps its attributes.
+/// Source: Michael Garland and Paul S. Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997.
+/// </summary>
+/// <param name="positions">The vertex positions of the mesh.</param>
+/// <param name="indices">The triangle indices of the mesh.</param>
+/// <param name="targetIndexCount">The number of indices to simplify the mesh to.</param>
+/// <param name="error">The largest distance between the simplified mesh and the input mesh (approximately).</param>
+/// <returns>The indices of the simplified mesh. The mesh is not simplified below targetIndexCount, but it may have more indices if the mesh can't be simplified further.</returns>
+std::vector<int> simplifyMesh( std::span<const glm::vec3> positions, std::span<const int> indices, std::size_t targetIndexCount, float& error );
+}  // namespace Graphics
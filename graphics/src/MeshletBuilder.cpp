@@ -0,0 +1,213 @@
+#include "MeshletBuilder.hpp"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+using namespace Graphics;
+
+namespace
+{
+/// <summary>
+/// Compute the bounding volumes and the normal cone of a meshlet.
+/// </summary>
+void computeBounds( std::span<const glm::vec3> positions, std::span<const int> indices, Mesh::Meshlet& meshlet )
+{
+    for ( int i: indices )
+        meshlet.aabb.expand( positions[i] );
+
+    meshlet.sphere.center = meshlet.aabb.center();
+    meshlet.sphere.radius = 0.0f;
+    for ( int i: indices )
+        meshlet.sphere.radius = std::max( meshlet.sphere.radius, glm::length( positions[i] - meshlet.sphere.center ) );
+
+    // The cone axis is the average of the (unit) triangle normals.
+    std::vector<glm::vec3> normals;
+    normals.reserve( indices.size() / 3 );
+
+    glm::vec3 axis { 0.0f };
+    for ( std::size_t i = 0; i < indices.size(); i += 3 )
+    {
+        const glm::vec3& p0 = positions[indices[i + 0]];
+        const glm::vec3& p1 = positions[indices[i + 1]];
+        const glm::vec3& p2 = positions[indices[i + 2]];
+
+        const glm::vec3 n   = glm::cross( p1 - p0, p2 - p0 );
+        const float     len = glm::length( n );
+
+        // Degenerate triangles are never rasterized, so they don't limit the cone.
+        if ( len == 0.0f )
+            continue;
+
+        normals.push_back( n / len );
+        axis += normals.back();
+    }
+
+    const float len = glm::length( axis );
+    if ( normals.empty() || len == 0.0f )
+        return;
+
+    axis /= len;
+
+    float minDot = 1.0f;
+    for ( const glm::vec3& n: normals )
+        minDot = std::min( minDot, glm::dot( axis, n ) );
+
+    meshlet.coneAxis = axis;
+
+    // If the normals are spread over more than a hemisphere, the triangles can't all face away from the camera.
+    meshlet.coneCutoff = minDot > 0.0f ? std::sqrt( 1.0f - minDot * minDot ) : 1.0f;
+}
+}  // namespace
+
+std::vector<Mesh::Meshlet> Graphics::buildMeshlets( std::span<const glm::vec3> positions, std::vector<int>& indices )
+{
+    const std::size_t numVertices  = positions.size();
+    const std::size_t numTriangles = indices.size() / 3;
+
+    // The triangles around each vertex.
+    std::vector<int> triangleOffsets( numVertices + 1, 0 );
+    for ( int i: indices )
+        ++triangleOffsets[i + 1];
+
+    std::partial_sum( triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin() );
+
+    std::vector<int> vertexTriangles( indices.size() );
+    {
+        std::vector<int> fill( triangleOffsets.begin(), triangleOffsets.end() - 1 );
+        for ( std::size_t i = 0; i < indices.size(); ++i )
+            vertexTriangles[fill[indices[i]]++] = static_cast<int>( i / 3 );
+    }
+
+    // The centroids of the triangles.
+    std::vector<glm::vec3> centroids( numTriangles );
+    for ( std::size_t t = 0; t < numTriangles; ++t )
+        centroids[t] = ( positions[indices[t * 3 + 0]] + positions[indices[t * 3 + 1]] + positions[indices[t * 3 + 2]] ) / 3.0f;
+
+    std::vector<int>  result;
+    std::vector<bool> emitted( numTriangles, false );
+    // The last meshlet that a vertex was added to, or that a triangle was added to the candidates of.
+    std::vector<int> vertexMeshlet( numVertices, -1 );
+    std::vector<int> candidateMeshlet( numTriangles, -1 );
+    std::vector<int> candidates;
+
+    result.reserve( indices.size() );
+
+    std::vector<Mesh::Meshlet> meshlets;
+
+    // The first triangle (in index order) that is not added to a meshlet.
+    std::size_t seed = 0;
+
+    while ( true )
+    {
+        while ( seed < numTriangles && emitted[seed] )
+            ++seed;
+
+        if ( seed == numTriangles )
+            break;
+
+        const int meshletId = static_cast<int>( meshlets.size() );
+
+        Mesh::Meshlet meshlet;
+        meshlet.firstIndex = static_cast<std::uint32_t>( result.size() );
+
+        std::size_t numMeshletVertices  = 0;
+        std::size_t numMeshletTriangles = 0;
+        glm::vec3   centroidSum { 0.0f };
+
+        candidates.clear();
+
+        int next = static_cast<int>( seed );
+        while ( next >= 0 )
+        {
+            // Add the triangle to the meshlet.
+            emitted[next] = true;
+            for ( int k = 0; k < 3; ++k )
+            {
+                const int v = indices[next * 3 + k];
+                result.push_back( v );
+
+                if ( vertexMeshlet[v] != meshletId )
+                {
+                    vertexMeshlet[v] = meshletId;
+                    ++numMeshletVertices;
+                }
+
+                // The triangles that share a vertex with the meshlet are candidates to add next.
+                for ( int j = triangleOffsets[v]; j < triangleOffsets[v + 1]; ++j )
+                {
+                    const int t = vertexTriangles[j];
+                    if ( !emitted[t] && candidateMeshlet[t] != meshletId )
+                    {
+                        candidateMeshlet[t] = meshletId;
+                        candidates.push_back( t );
+                    }
+                }
+            }
+
+            centroidSum += centroids[next];
+
+            if ( ++numMeshletTriangles == Mesh::MaxMeshletTriangles )
+                break;
+
+            // Select the candidate that adds the fewest vertices to the meshlet,
+            // and is closest to the center of the meshlet.
+            const glm::vec3 center   = centroidSum / static_cast<float>( numMeshletTriangles );
+            int             bestNew  = std::numeric_limits<int>::max();
+            float           bestDist = std::numeric_limits<float>::max();
+
+            next = -1;
+            for ( std::size_t i = 0; i < candidates.size(); )
+            {
+                const int t = candidates[i];
+                if ( emitted[t] )
+                {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+
+                ++i;
+
+                int newVertices = 0;
+                for ( int k = 0; k < 3; ++k )
+                    newVertices += vertexMeshlet[indices[t * 3 + k]] != meshletId;
+
+                if ( numMeshletVertices + newVertices > Mesh::MaxMeshletVertices )
+                    continue;
+
+                const glm::vec3 d    = centroids[t] - center;
+                const float     dist = glm::dot( d, d );
+                if ( newVertices < bestNew || ( newVertices == bestNew && dist < bestDist ) )
+                {
+                    next     = t;
+                    bestNew  = newVertices;
+                    bestDist = dist;
+                }
+            }
+
+            // If none of the triangles around the meshlet fit, continue with the next triangle in index order.
+            // This packs small disconnected pieces (that are usually close together in the index buffer) into a single meshlet.
+            if ( next < 0 && candidates.empty() && numMeshletVertices + 3 <= Mesh::MaxMeshletVertices )
+            {
+                while ( seed < numTriangles && emitted[seed] )
+                    ++seed;
+
+                if ( seed < numTriangles )
+                    next = static_cast<int>( seed );
+            }
+        }
+
+        meshlet.indexCount = static_cast<std::uint32_t>( result.size() ) - meshlet.firstIndex;
+        computeBounds( positions, std::span { result }.subspan( meshlet.firstIndex, meshlet.indexCount ), meshlet );
+
+        meshlets.push_back( meshlet );
+    }
+
+    indices = std::move( result );
+
+    return meshlets;
+}
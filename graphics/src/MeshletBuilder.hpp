@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Graphics/Mesh.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <span>
+#include <vector>
+
+namespace Graphics
+{
+/// <summary>
+/// Split an indexed triangle mesh into meshlets of at most Mesh::MaxMeshletVertices vertices and Mesh::MaxMeshletTriangles triangles.
+/// Meshlets are grown greedily from a seed triangle by adding the neighboring triangle that adds the fewest new vertices
+/// (and is closest to the center of the meshlet), so the meshlets are compact and can be culled with tight bounds.
+/// The index buffer is reordered so the triangles of each meshlet are contiguous.
+/// Source: Arseny Kapoulkine, "meshoptimizer" (https://github.com/zeux/meshoptimizer).
+/// </summary>
+/// <param name="positions">The vertex positions of the mesh.</param>
+/// <param name="indices">The triangle indices of the mesh. The triangles are reordered by meshlet.</param>
+/// <returns>The meshlets with their bounding volumes and normal cones.</returns>
+std::vector<Mesh::Meshlet> buildMeshlets( std::span<const glm::vec3> positions, std::vector<int>& indices );
+}  // namespace Graphics
@@ -1,15 +1,40 @@
 #include <Graphics/Model.hpp>
 #include <Graphics/ResourceManager.hpp>
 
+#include <hash.hpp>
 #include <tiny_obj_loader.h>
 
 // Check that tinyobj loader is configured to use floats.
 static_assert( std::is_same_v<tinyobj::real_t, float> );
 
 #include <iostream>
+#include <unordered_map>
 
 using namespace Graphics;
 
+namespace tinyobj
+{
+inline bool operator==( const index_t& lhs, const index_t& rhs ) noexcept
+{
+    return lhs.vertex_index == rhs.vertex_index && lhs.normal_index == rhs.normal_index && lhs.texcoord_index == rhs.texcoord_index;
+}
+}  // namespace tinyobj
+
+template<>
+struct std::hash<tinyobj::index_t>
+{
+    size_t operator()( const tinyobj::index_t& idx ) const noexcept
+    {
+        size_t seed = 0;
+
+        hash_combine( seed, idx.vertex_index );
+        hash_combine( seed, idx.normal_index );
+        hash_combine( seed, idx.texcoord_index );
+
+        return seed;
+    }
+};
+
 constexpr Color ParseColor( const tinyobj::real_t color[3] ) noexcept
 {
     return {
@@ -19,7 +44,7 @@ constexpr Color ParseColor( const tinyobj::real_t color[3] ) noexcept
     };
 }
 
-inline std::shared_ptr<Material> ParseMaterial( const std::filesystem::path& basePath, const tinyobj::material_t& material ) noexcept
+inline std::shared_ptr<Material> ParseMaterial( const std::filesystem::path& basePath, const tinyobj::material_t& material, TextureLayout textureLayout ) noexcept
 {
     Color diffuseColor  = ParseColor( material.diffuse );
     Color specularColor = ParseColor( material.specular );
@@ -28,8 +53,8 @@ inline std::shared_ptr<Material> ParseMaterial( const std::filesystem::path& bas
     float specularPower = material.shininess;
 
     // TODO: Check if we need to prefix with path to model file.
-    auto diffuseTexture  = material.diffuse_texname.empty() ? nullptr : ResourceManager::loadImage( basePath / material.diffuse_texname );
-    auto alphaTexture  = material.alpha_texname.empty() ? nullptr : ResourceManager::loadImage( basePath / material.alpha_texname );
+    auto diffuseTexture  = material.diffuse_texname.empty() ? nullptr : ResourceManager::loadTexture( basePath / material.diffuse_texname, textureLayout );
+    auto alphaTexture  = material.alpha_texname.empty() ? nullptr : ResourceManager::loadTexture( basePath / material.alpha_texname, textureLayout );
     auto specularTexture = material.specular_texname.empty() ? nullptr : ResourceManager::loadImage( basePath / material.specular_texname );
     auto normalTexture   = material.bump_texname.empty() ? nullptr : ResourceManager::loadImage( basePath / material.bump_texname );
     auto ambientTexture  = material.ambient_texname.empty() ? nullptr : ResourceManager::loadImage( basePath / material.ambient_texname );
@@ -43,12 +68,16 @@ inline std::shared_ptr<Mesh> ParseMesh( const tinyobj::mesh_t& mesh, const tinyo
     std::vector<Vertex3D> vertices;
     std::vector<int>      indices;
 
+    // Face vertices that refer to the same position, normal, and texture coordinate
+    // are welded into a single vertex.
+    std::unordered_map<tinyobj::index_t, int> vertexMap;
+
     // Reserve 3 vertices per face (we assume the mesh is triangulated).
     vertices.reserve( mesh.num_face_vertices.size() * 3 );
     indices.reserve( mesh.num_face_vertices.size() * 3 );
+    vertexMap.reserve( mesh.num_face_vertices.size() * 3 );
 
     size_t indexOffset = 0;
-    int    i           = 0;
     // Loop over the faces of the mesh
     for ( size_t numVerts: mesh.num_face_vertices )
     {
@@ -60,6 +89,14 @@ inline std::shared_ptr<Mesh> ParseMesh( const tinyobj::mesh_t& mesh, const tinyo
         {
             auto idx = mesh.indices[indexOffset + v];
 
+            // Check if this vertex was already added to the mesh.
+            auto [iter, inserted] = vertexMap.try_emplace( idx, static_cast<int>( vertices.size() ) );
+            if ( !inserted )
+            {
+                indices.push_back( iter->second );
+                continue;
+            }
+
             Vertex3D vert {};
 
             vert.position.x = attrib.vertices[idx.vertex_index * 3 + 0];
@@ -83,8 +120,8 @@ inline std::shared_ptr<Mesh> ParseMesh( const tinyobj::mesh_t& mesh, const tinyo
             vert.color.g = static_cast<uint8_t>( attrib.colors[idx.vertex_index * 3 + 1] * 255u );
             vert.color.b = static_cast<uint8_t>( attrib.colors[idx.vertex_index * 3 + 2] * 255u );
 
+            indices.push_back( iter->second );
             vertices.emplace_back( vert );
-            indices.push_back( i++ );
         }
 
         indexOffset += numVerts;
@@ -100,7 +137,7 @@ Model::~Model()                             = default;
 Model& Model::operator=( const Model& )     = default;
 Model& Model::operator=( Model&& ) noexcept = default;
 
-Model::Model( const std::filesystem::path& modelFile )
+Model::Model( const std::filesystem::path& modelFile, std::size_t numLODs, TextureLayout textureLayout )
 {
     if ( !std::filesystem::exists( modelFile ) || !std::filesystem::is_regular_file( modelFile ) )
     {
@@ -138,7 +175,7 @@ Model::Model( const std::filesystem::path& modelFile )
     const auto basePath = modelFile.parent_path();
     for ( const auto& m: reader.GetMaterials() )
     {
-        const auto material = ParseMaterial( basePath, m );
+        const auto material = ParseMaterial( basePath, m, textureLayout );
         materials.emplace_back( material );
     }
 
@@ -167,6 +204,16 @@ Model::Model( const std::filesystem::path& modelFile )
         // Add the mesh to the model's meshes array.
         meshes.emplace_back( mesh );
     }
+
+    // Generate the levels of detail of the meshes.
+    if ( numLODs > 0 )
+    {
+#pragma omp parallel for schedule( dynamic )
+        for ( int i = 0; i < static_cast<int>( meshes.size() ); ++i )
+        {
+            meshes[i]->generateLODs( numLODs );
+        }
+    }
 }
 
 const std::vector<std::shared_ptr<Mesh>>& Model::getMeshes() const
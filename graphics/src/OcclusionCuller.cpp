@@ -0,0 +1,248 @@
+#include <Graphics/OcclusionCuller.hpp>
+
+#include <Math/Frustum.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+using namespace Graphics;
+using namespace Math;
+
+OcclusionCuller::OcclusionCuller()
+: OcclusionCuller( DefaultWidth, DefaultHeight )
+{}
+
+OcclusionCuller::OcclusionCuller( std::size_t width, std::size_t height )
+: width { width }
+, height { height }
+, depthBuffer { width, height }
+{
+    clear();
+}
+
+void OcclusionCuller::clear()
+{
+    depthBuffer.clear( 1.0f );
+}
+
+void OcclusionCuller::setCamera( const Math::Camera* _camera ) noexcept
+{
+    camera = _camera;
+}
+
+void OcclusionCuller::drawOccluder( const Mesh& mesh, const glm::mat4& modelMatrix )
+{
+    const glm::mat4 modelViewProjectionMatrix = camera ? camera->getViewProjectionMatrix() * modelMatrix : modelMatrix;
+
+    // Occluders outside of the view frustum don't occlude anything.
+    if ( Frustum( modelViewProjectionMatrix ).contains( mesh.getAABB() ) == Containment::Outside )
+        return;
+
+    // Mesh must be triangulated.
+    assert( mesh.getNumIndices() % 3 == 0 );
+
+    const auto& positions = mesh.getPositions();
+    const auto& indices   = mesh.getIndices();
+
+    clipPositions.resize( positions.size() );
+    for ( std::size_t i = 0; i < positions.size(); ++i )
+        clipPositions[i] = modelViewProjectionMatrix * glm::vec4 { positions[i], 1.0f };
+
+    for ( std::size_t i = 0; i + 2 < indices.size(); i += 3 )
+    {
+        const glm::vec4 v[] = {
+            clipPositions[indices[i + 0]],
+            clipPositions[indices[i + 1]],
+            clipPositions[indices[i + 2]]
+        };
+
+        drawTriangle( v );
+    }
+}
+
+bool OcclusionCuller::isOccluded( const Math::AABB& aabb, const glm::mat4& modelMatrix ) const noexcept
+{
+    const glm::mat4 modelViewProjectionMatrix = camera ? camera->getViewProjectionMatrix() * modelMatrix : modelMatrix;
+
+    // Screen-space bounds and the nearest depth of the bounding box.
+    glm::vec3 min { std::numeric_limits<float>::max() };
+    glm::vec3 max { std::numeric_limits<float>::lowest() };
+
+    for ( int i = 0; i < 8; ++i )
+    {
+        const glm::vec3 corner {
+            i & 1 ? aabb.max.x : aabb.min.x,
+            i & 2 ? aabb.max.y : aabb.min.y,
+            i & 4 ? aabb.max.z : aabb.min.z
+        };
+
+        const glm::vec4 p = modelViewProjectionMatrix * glm::vec4 { corner, 1.0f };
+
+        // The bounding box crosses the near plane and can't be projected to the screen.
+        if ( !( p.z + p.w > 0.0f ) )
+            return false;
+
+        const glm::vec3 s = toScreen( p );
+
+        min = glm::min( min, s );
+        max = glm::max( max, s );
+    }
+
+    // All pixels that are (partially) overlapped by the bounding box.
+    const int x0 = std::max( static_cast<int>( std::floor( min.x ) ), 0 );
+    const int y0 = std::max( static_cast<int>( std::floor( min.y ) ), 0 );
+    const int x1 = std::min( static_cast<int>( std::floor( max.x ) ), static_cast<int>( width ) - 1 );
+    const int y1 = std::min( static_cast<int>( std::floor( max.y ) ), static_cast<int>( height ) - 1 );
+
+    // The bounding box is not on the screen (this is handled by view frustum culling).
+    if ( x0 > x1 || y0 > y1 )
+        return false;
+
+    // The bounding box is occluded if its nearest depth is behind the occluders in all pixels.
+    for ( int y = y0; y <= y1; ++y )
+    {
+        const float* depthRow = &depthBuffer( 0, y );
+        for ( int x = x0; x <= x1; ++x )
+        {
+            if ( !( min.z > depthRow[x] ) )
+                return false;
+        }
+    }
+
+    return true;
+}
+
+const Buffer<float>& OcclusionCuller::getDepthBuffer() const noexcept
+{
+    return depthBuffer;
+}
+
+void OcclusionCuller::drawTriangle( const glm::vec4 v[3] )
+{
+    // Trivial reject: the triangle is completely outside of one of the clipping planes.
+    const auto outside = [v]( auto&& test ) {
+        return test( v[0] ) && test( v[1] ) && test( v[2] );
+    };
+
+    if ( outside( []( const glm::vec4& p ) { return p.x < -p.w; } ) ||
+         outside( []( const glm::vec4& p ) { return p.x > p.w; } ) ||
+         outside( []( const glm::vec4& p ) { return p.y < -p.w; } ) ||
+         outside( []( const glm::vec4& p ) { return p.y > p.w; } ) ||
+         outside( []( const glm::vec4& p ) { return p.z > p.w; } ) )
+        return;
+
+    // Clip the triangle against the near plane (z + w >= 0).
+    // Clipping against the other planes is not required since the rasterization is clamped to the screen.
+    glm::vec4 clipped[4];
+    int       n = 0;
+
+    for ( int i = 0; i < 3; ++i )
+    {
+        const glm::vec4& a  = v[i];
+        const glm::vec4& b  = v[( i + 1 ) % 3];
+        const float      da = a.z + a.w;
+        const float      db = b.z + b.w;
+
+        if ( da >= 0.0f )
+            clipped[n++] = a;
+
+        if ( ( da >= 0.0f ) != ( db >= 0.0f ) )
+            clipped[n++] = a + ( b - a ) * ( da / ( da - db ) );
+    }
+
+    if ( n < 3 )
+        return;
+
+    glm::vec3 screen[4];
+    for ( int i = 0; i < n; ++i )
+        screen[i] = toScreen( clipped[i] );
+
+    // Triangulate the clipped polygon as a triangle fan.
+    for ( int i = 1; i + 1 < n; ++i )
+    {
+        glm::vec3 p[] = { screen[0], screen[i], screen[i + 1] };
+        rasterizeTriangle( p );
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle( glm::vec3 p[3] )
+{
+    float area = ( p[1].x - p[0].x ) * ( p[2].y - p[0].y ) - ( p[2].x - p[0].x ) * ( p[1].y - p[0].y );
+
+    // Reject degenerate triangles (this also rejects NaN coordinates).
+    if ( !( std::abs( area ) > 0.0f ) )
+        return;
+
+    // Occluders are two-sided.
+    if ( area < 0.0f )
+    {
+        std::swap( p[1], p[2] );
+        area = -area;
+    }
+
+    // Only the pixels that are completely inside of the triangle are written.
+    const int minX = std::max( static_cast<int>( std::ceil( std::min( { p[0].x, p[1].x, p[2].x } ) ) ), 0 );
+    const int minY = std::max( static_cast<int>( std::ceil( std::min( { p[0].y, p[1].y, p[2].y } ) ) ), 0 );
+    const int maxX = std::min( static_cast<int>( std::floor( std::max( { p[0].x, p[1].x, p[2].x } ) ) ), static_cast<int>( width ) ) - 1;
+    const int maxY = std::min( static_cast<int>( std::floor( std::max( { p[0].y, p[1].y, p[2].y } ) ) ), static_cast<int>( height ) ) - 1;
+
+    if ( minX > maxX || minY > maxY )
+        return;
+
+    // Edge equations: E(x, y) = a * x + b * y + c >= 0 for points inside of the triangle.
+    float a[3], b[3], c[3];
+    for ( int i = 0; i < 3; ++i )
+    {
+        const glm::vec3& p0 = p[i];
+        const glm::vec3& p1 = p[( i + 1 ) % 3];
+
+        a[i] = p0.y - p1.y;
+        b[i] = p1.x - p0.x;
+        // Move the edge inwards by half a pixel, so the edge equation evaluated
+        // at the center of a pixel is non-negative only if the whole pixel is inside the edge.
+        c[i] = -( a[i] * p0.x + b[i] * p0.y ) - 0.5f * ( std::abs( a[i] ) + std::abs( b[i] ) );
+    }
+
+    // The depth is linear in screen space: z(x, y) = z0 + dzdx * (x - x0) + dzdy * (y - y0).
+    const float dzdx = ( ( p[1].z - p[0].z ) * ( p[2].y - p[0].y ) - ( p[2].z - p[0].z ) * ( p[1].y - p[0].y ) ) / area;
+    const float dzdy = ( ( p[2].z - p[0].z ) * ( p[1].x - p[0].x ) - ( p[1].z - p[0].z ) * ( p[2].x - p[0].x ) ) / area;
+
+    // The farthest depth in a pixel is at one of its corners.
+    const float maxOffset = 0.5f * ( std::abs( dzdx ) + std::abs( dzdy ) );
+
+    // The depth is also bounded by the depth of the vertices.
+    const float minZ = std::min( { p[0].z, p[1].z, p[2].z } );
+    const float maxZ = std::max( { p[0].z, p[1].z, p[2].z } );
+
+    for ( int y = minY; y <= maxY; ++y )
+    {
+        const float py = static_cast<float>( y ) + 0.5f;
+
+        float* depthRow = &depthBuffer( 0, y );
+
+        for ( int x = minX; x <= maxX; ++x )
+        {
+            const float px = static_cast<float>( x ) + 0.5f;
+
+            if ( a[0] * px + b[0] * py + c[0] < 0.0f || a[1] * px + b[1] * py + c[1] < 0.0f || a[2] * px + b[2] * py + c[2] < 0.0f )
+                continue;
+
+            const float z = std::clamp( p[0].z + dzdx * ( px - p[0].x ) + dzdy * ( py - p[0].y ) + maxOffset, minZ, maxZ );
+
+            depthRow[x] = std::min( depthRow[x], z );
+        }
+    }
+}
+
+glm::vec3 OcclusionCuller::toScreen( const glm::vec4& p ) const noexcept
+{
+    const glm::vec3 ndc = glm::vec3 { p } / p.w;
+
+    return {
+        ( ndc.x * 0.5f + 0.5f ) * static_cast<float>( width ),
+        ( 0.5f - ndc.y * 0.5f ) * static_cast<float>( height ),  // Flip Y
+        ndc.z * 0.5f + 0.5f
+    };
+}
@@ -1,162 +1,1941 @@
+#include <Graphics/OcclusionCuller.hpp>
 #include <Graphics/Rasterizer.hpp>
+#include <Graphics/ShadowMap.hpp>
+
+#include "DepthTraits.hpp"
+#include "SIMD.hpp"
+
+#include <Math/Frustum.hpp>
+
+#include <glm/matrix.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <utility>
 
 using namespace Graphics;
 using namespace Math;
 
-Rasterizer::Rasterizer() = default;
+namespace
+{
+using Clock = std::chrono::high_resolution_clock;
+
+/// <summary>
+/// Get the time (in milliseconds) that elapsed since a time point.
+/// </summary>
+double elapsedMilliseconds( Clock::time_point start ) noexcept
+{
+    return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+}
+
+/// <summary>
+/// The number of pipeline states (depth formats x passes x alpha test x diffuse texture x visibility buffer x multisample x shadows).
+/// </summary>
+constexpr std::size_t NumPipelineStates = 3 * 3 * 2 * 2 * 2 * 2 * 2;
+
+/// <summary>
+/// Get the pipeline state with the given index (see pipelineStateIndex).
+/// State that is not used by the pass is cleared, so equivalent states share the same kernel.
+/// </summary>
+constexpr Rasterizer::PipelineState makePipelineState( std::size_t index ) noexcept
+{
+    Rasterizer::PipelineState state;
+
+    state.shadows = index % 2 != 0;
+    index /= 2;
+    state.multisample = index % 2 != 0;
+    index /= 2;
+    state.visibilityBuffer = index % 2 != 0;
+    index /= 2;
+    state.diffuseTexture = index % 2 != 0;
+    index /= 2;
+    state.alphaTest = index % 2 != 0;
+    index /= 2;
+    state.pass = static_cast<Rasterizer::RasterPass>( index % 3 );
+    index /= 3;
+    state.depthFormat = static_cast<Rasterizer::DepthFormat>( index );
+
+    // The depth pre-pass doesn't shade the fragments.
+    if ( state.pass == Rasterizer::RasterPass::Depth )
+        state.visibilityBuffer = false;
+
+    // With a visibility buffer, the diffuse texture is sampled when the visibility buffer is resolved.
+    if ( state.pass == Rasterizer::RasterPass::Depth || state.visibilityBuffer )
+        state.diffuseTexture = false;
+
+    // The shadows are applied when the fragments are shaded (or when the visibility buffer is resolved).
+    if ( state.pass == Rasterizer::RasterPass::Depth || state.visibilityBuffer )
+        state.shadows = false;
+
+    return state;
+}
+
+/// <summary>
+/// Get the index of a pipeline state in the kernel table.
+/// </summary>
+constexpr std::size_t pipelineStateIndex( const Rasterizer::PipelineState& state ) noexcept
+{
+    std::size_t index = static_cast<std::size_t>( state.depthFormat );
+    index             = index * 3 + static_cast<std::size_t>( state.pass );
+    index             = index * 2 + ( state.alphaTest ? 1 : 0 );
+    index             = index * 2 + ( state.diffuseTexture ? 1 : 0 );
+    index             = index * 2 + ( state.visibilityBuffer ? 1 : 0 );
+    index             = index * 2 + ( state.multisample ? 1 : 0 );
+    index             = index * 2 + ( state.shadows ? 1 : 0 );
+
+    return index;
+}
+
+/// <summary>
+/// Decode a normalized integer depth buffer to floating-point depth values.
+/// With multisampling, only the first sample of each pixel is decoded.
+/// </summary>
+template<Rasterizer::DepthFormat Format>
+void decodeDepth( const Buffer<typename DepthTraits<Format>::Type>& src, Buffer<float>& dst, std::size_t samples )
+{
+    dst.resize( src.getWidth() / samples, src.getHeight() );
+
+    const std::size_t size = dst.getWidth() * dst.getHeight();
+    for ( std::size_t i = 0; i < size; ++i )
+        dst[i] = DepthTraits<Format>::decode( src[i * samples] );
+}
+}  // namespace
+
+Rasterizer::Rasterizer() = default;
+
+Rasterizer::Rasterizer( std::size_t width, std::size_t height, DepthFormat depthFormat )
+: width { width }
+, height { height }
+, renderTarget { static_cast<uint32_t>( width ), static_cast<uint32_t>( height ) }
+, depthFormat { depthFormat }
+, hiZMin { ( width + BlockSize - 1 ) / BlockSize, ( height + BlockSize - 1 ) / BlockSize }
+, hiZMax { ( width + BlockSize - 1 ) / BlockSize, ( height + BlockSize - 1 ) / BlockSize }
+, viewport { 0.0f, 0.0f, static_cast<float>( width ), static_cast<float>( height ) }
+, numTilesX { static_cast<int>( ( width + TileSize - 1 ) / TileSize ) }
+, numTilesY { static_cast<int>( ( height + TileSize - 1 ) / TileSize ) }
+, tileBins( static_cast<std::size_t>( numTilesX ) * numTilesY )
+{
+    switch ( depthFormat )
+    {
+    case DepthFormat::Float32:
+        depthBuffer.resize( width, height );
+        break;
+    case DepthFormat::Unorm24:
+        depthBuffer24.resize( width, height );
+        break;
+    case DepthFormat::Unorm16:
+        depthBuffer16.resize( width, height );
+        break;
+    }
+}
+
+template<Rasterizer::DepthFormat Format>
+auto& Rasterizer::getDepthTarget() noexcept
+{
+    if constexpr ( Format == DepthFormat::Float32 )
+        return boundDepthTarget ? *boundDepthTarget : depthBuffer;
+    else if constexpr ( Format == DepthFormat::Unorm24 )
+        return depthBuffer24;
+    else
+        return depthBuffer16;
+}
+
+void Rasterizer::clear( const Color& color, float depth )
+{
+    if ( !renderTargetAcquired )
+        acquireRenderTarget();
+
+    // Only the pixels inside the viewport are cleared, so the color and depth targets can be shared with other passes.
+    const RectI rect       = getViewportRect();
+    const bool  fullTarget = rect.left == 0 && rect.top == 0 && rect.width == static_cast<int>( width ) && rect.height == static_cast<int>( height );
+    const int   samples    = multisampling ? NumSamples : 1;
+
+    Image& colorTarget = getColorTarget();
+    if ( fullTarget && colorTarget.getWidth() == width && colorTarget.getHeight() == height )
+    {
+        colorTarget.clear( color );
+    }
+    else
+    {
+        for ( int y = rect.top; y < rect.bottom(); ++y )
+            std::fill_n( &colorTarget( rect.left, y ), rect.width, color );
+    }
+
+    if ( multisampling )
+        colorSamples.clear( color );
+
+    auto clearDepth = [&]( auto& depthTarget, auto value ) {
+        if ( fullTarget )
+        {
+            depthTarget.clear( value );
+        }
+        else
+        {
+            for ( int y = rect.top; y < rect.bottom(); ++y )
+                std::fill_n( &depthTarget( static_cast<std::size_t>( rect.left ) * samples, y ), static_cast<std::size_t>( rect.width ) * samples, value );
+        }
+    };
+
+    // The hierarchical depth stores the depth that is actually stored in the depth buffer.
+    float hiZ = depth;
+    switch ( depthFormat )
+    {
+    case DepthFormat::Float32:
+        clearDepth( getDepthTarget<DepthFormat::Float32>(), depth );
+        break;
+    case DepthFormat::Unorm24:
+        clearDepth( depthBuffer24, DepthTraits<DepthFormat::Unorm24>::encode( depth ) );
+        hiZ = DepthTraits<DepthFormat::Unorm24>::decode( DepthTraits<DepthFormat::Unorm24>::encode( depth ) );
+        break;
+    case DepthFormat::Unorm16:
+        clearDepth( depthBuffer16, DepthTraits<DepthFormat::Unorm16>::encode( depth ) );
+        hiZ = DepthTraits<DepthFormat::Unorm16>::decode( DepthTraits<DepthFormat::Unorm16>::encode( depth ) );
+        break;
+    }
+
+    if ( fullTarget )
+    {
+        hiZMin.clear( hiZ );
+        hiZMax.clear( hiZ );
+    }
+    else
+    {
+        // The blocks on the border of the viewport also contain pixels that were not cleared.
+        updateHiZ( rect );
+    }
+
+    if ( shadingMode == ShadingMode::VisibilityBuffer )
+    {
+        visibilityBuffer.clear( InvalidVisibilityId );
+        frameCommands.clear();
+        frameTriangles.clear();
+    }
+
+    statistics = {};
+}
+
+std::uint64_t Rasterizer::makeVisibilityId( const Triangle& tri ) const noexcept
+{
+    return static_cast<std::uint64_t>( visibilityDrawOffset + tri.drawId ) << 32 | tri.triangleId;
+}
+
+void Rasterizer::draw( const Mesh& mesh, const glm::mat4& modelMatrix )
+{
+    commands.clear();
+    commands.push_back( makeDrawCommand( mesh, modelMatrix ) );
+
+    execute();
+}
+
+void Rasterizer::drawInstanced( const Mesh& mesh, std::span<const glm::mat4> modelMatrices )
+{
+    // The instances only differ by their model matrix.
+    const DrawCommand command = makeDrawCommand( mesh, glm::mat4 { 1.0f } );
+
+    commands.assign( modelMatrices.size(), command );
+    for ( std::size_t i = 0; i < modelMatrices.size(); ++i )
+        commands[i].modelMatrix = modelMatrices[i];
+
+    if ( commands.empty() )
+        return;
+
+    sortDrawCommands();
+    execute();
+}
+
+void Rasterizer::submit( const Mesh& mesh, const glm::mat4& modelMatrix )
+{
+    const DrawCommand command = makeDrawCommand( mesh, modelMatrix );
+
+    std::lock_guard lock( submitMutex );
+    submittedCommands.push_back( command );
+}
+
+void Rasterizer::flush()
+{
+    {
+        std::lock_guard lock( submitMutex );
+        std::swap( commands, submittedCommands );
+        submittedCommands.clear();
+    }
+
+    if ( commands.empty() )
+        return;
+
+    sortDrawCommands();
+    execute();
+}
+
+void Rasterizer::sortDrawCommands()
+{
+    if ( !camera )
+        return;
+
+    // Sort the draw commands front to back so the hierarchical depth buffer
+    // can reject the blocks of meshes that are hidden behind meshes that are already drawn.
+    const glm::mat4& viewMatrix = camera->getViewMatrix();
+    for ( DrawCommand& command: commands )
+        command.depth = -( viewMatrix * command.modelMatrix * glm::vec4 { command.mesh->getAABB().center(), 1.0f } ).z;
+
+    std::stable_sort( commands.begin(), commands.end(), []( const DrawCommand& lhs, const DrawCommand& rhs ) {
+        return lhs.depth < rhs.depth;
+    } );
+}
+
+Rasterizer::DrawCommand Rasterizer::makeDrawCommand( const Mesh& mesh, const glm::mat4& modelMatrix ) noexcept
+{
+    const Material* material = mesh.getMaterial().get();
+
+    // Textures that failed to load are not bound.
+    auto validTexture = []( const std::shared_ptr<Texture>& texture ) -> const Texture* {
+        return texture && *texture ? texture.get() : nullptr;
+    };
+
+    DrawCommand command;
+    command.mesh           = &mesh;
+    command.modelMatrix    = modelMatrix;
+    command.alphaTexture   = material ? validTexture( material->alphaTexture ) : nullptr;
+    command.diffuseTexture = material ? validTexture( material->diffuseTexture ) : nullptr;
+    command.diffuseColor   = material ? material->diffuseColor : Color::Magenta;
+
+    return command;
+}
+
+void Rasterizer::execute()
+{
+    // After present, the render targets belong to the frame until clear acquires the render targets of the next frame.
+    assert( renderTargetAcquired );
+
+    const int numCommands = static_cast<int>( commands.size() );
+
+    commandVertices.resize( numCommands );
+    commandTriangles.resize( numCommands );
+    commandStatistics.assign( numCommands, {} );
+
+    // Select the level of detail and the rasterization kernels of the draw commands.
+    for ( DrawCommand& command: commands )
+    {
+        if ( !command.mesh->getLODs().empty() && camera )
+        {
+            const float screenSize = getScreenSize( command.mesh->getAABB(), camera->getViewMatrix() * command.modelMatrix );
+            const Mesh& lod        = command.mesh->selectLOD( screenSize, lodThreshold );
+            if ( &lod != command.mesh )
+            {
+                command.mesh = &lod;
+                ++statistics.meshesSimplified;
+            }
+        }
+
+        command.shadows = shadowMap != nullptr;
+
+        PipelineState state;
+        state.depthFormat      = depthFormat;
+        state.alphaTest        = command.alphaTexture != nullptr;
+        state.diffuseTexture   = command.diffuseTexture != nullptr;
+        state.visibilityBuffer = shadingMode == ShadingMode::VisibilityBuffer;
+        state.multisample      = multisampling;
+        state.shadows          = command.shadows;
+
+        state.pass          = RasterPass::Depth;
+        command.depthKernel = getKernel( state );
+
+        // With a depth pre-pass, the depth of all triangles is rasterized before the triangles are shaded.
+        state.pass          = depthPrePass ? RasterPass::ShadeEqual : RasterPass::Shade;
+        command.shadeKernel = getKernel( state );
+    }
+
+    // Process the geometry of the draw commands in parallel.
+#pragma omp parallel for schedule( dynamic ) if ( numCommands > 1 )
+    for ( int i = 0; i < numCommands; ++i )
+        processDrawCommand( commands[i], static_cast<std::uint32_t>( i ), commandVertices[i], commandTriangles[i], commandStatistics[i] );
+
+    // Gather the triangles of all draw commands in draw order.
+    triangles.clear();
+    for ( int i = 0; i < numCommands; ++i )
+    {
+        triangles.insert( triangles.end(), commandTriangles[i].begin(), commandTriangles[i].end() );
+        statistics += commandStatistics[i];
+    }
+
+    // The draw IDs in the visibility buffer index the draw commands of the whole frame.
+    visibilityDrawOffset = static_cast<std::uint32_t>( frameCommands.size() );
+
+    const auto rasterStart = Clock::now();
+
+    rasterizeTriangles();
+
+    statistics.rasterTime += elapsedMilliseconds( rasterStart );
+
+    // Keep the draw commands and their triangles until the visibility buffer is resolved.
+    if ( shadingMode == ShadingMode::VisibilityBuffer )
+    {
+        for ( int i = 0; i < numCommands; ++i )
+        {
+            frameCommands.push_back( commands[i] );
+            frameTriangles.push_back( std::move( commandTriangles[i] ) );
+        }
+    }
+}
+
+void Rasterizer::resolve()
+{
+    assert( renderTargetAcquired );
+
+    const auto shadeStart = Clock::now();
+
+    if ( shadingMode == ShadingMode::VisibilityBuffer )
+        shadeVisibilityBuffer();
+
+    if ( multisampling )
+        resolveSamples();
+
+    statistics.shadeTime += elapsedMilliseconds( shadeStart );
+}
+
+void Rasterizer::setNumRenderTargets( std::size_t count )
+{
+    assert( count >= 1 && count <= MaxRenderTargets );
+
+    // The render targets of the frames may be moved in any order after this, so all consumers must be done.
+    for ( const auto& frame: frames )
+        frame.fence.wait();
+
+    numRenderTargets    = std::clamp<std::size_t>( count, 1u, MaxRenderTargets );
+    currentRenderTarget = currentRenderTarget % numRenderTargets;
+
+    // Release the render targets of the frames that are no longer in the ring (unless the frame was just presented).
+    for ( std::size_t i = numRenderTargets; i < MaxRenderTargets; ++i )
+    {
+        if ( &frames[i] == presentedFrame )
+            continue;
+
+        frames[i].image       = Image {};
+        frames[i].depthBuffer = Buffer<float> {};
+    }
+}
+
+std::size_t Rasterizer::getNumRenderTargets() const noexcept
+{
+    return numRenderTargets;
+}
+
+Rasterizer::Frame& Rasterizer::present()
+{
+    Frame& frame = frames[currentRenderTarget];
+
+    // The frame is only reused once its previous consumer is done with it.
+    frame.fence.wait();
+    frame.fence.reset();
+
+    // The render targets that are owned by the rasterizer are moved (not copied) into the frame, so the rasterizer doesn't
+    // keep a render target of its own until the next clear moves the render targets of the next frame back (see acquireRenderTarget).
+    // Bound render targets belong to the caller, so their contents are copied into the frame instead.
+    if ( boundColorTarget )
+        frame.image = *boundColorTarget;
+    else
+        frame.image = std::move( renderTarget );
+
+    const std::size_t samples = multisampling ? NumSamples : 1;
+
+    switch ( depthFormat )
+    {
+    case DepthFormat::Float32:
+        if ( multisampling )
+            decodeDepth<DepthFormat::Float32>( getDepthTarget<DepthFormat::Float32>(), frame.depthBuffer, samples );
+        else if ( boundDepthTarget )
+            frame.depthBuffer = *boundDepthTarget;
+        else
+            frame.depthBuffer = std::move( depthBuffer );
+        break;
+    case DepthFormat::Unorm24:
+        decodeDepth<DepthFormat::Unorm24>( depthBuffer24, frame.depthBuffer, samples );
+        break;
+    case DepthFormat::Unorm16:
+        decodeDepth<DepthFormat::Unorm16>( depthBuffer16, frame.depthBuffer, samples );
+        break;
+    }
+
+    currentRenderTarget  = ( currentRenderTarget + 1 ) % numRenderTargets;
+    renderTargetAcquired = false;
+    presentedFrame       = &frame;
+
+    return frame;
+}
+
+void Rasterizer::acquireRenderTarget()
+{
+    Frame& frame = frames[currentRenderTarget];
+
+    // Wait until the consumer of the frame that was last rendered into this render target is done.
+    frame.fence.wait();
+
+    // The render targets of a frame that was never presented are allocated by resize.
+    renderTarget = std::move( frame.image );
+    renderTarget.resize( static_cast<uint32_t>( width ), static_cast<uint32_t>( height ) );
+
+    // Only a single-sampled floating-point depth buffer is moved into the frame (the other depth buffers are decoded).
+    if ( depthFormat == DepthFormat::Float32 && !multisampling )
+    {
+        depthBuffer = std::move( frame.depthBuffer );
+        depthBuffer.resize( width, height );
+    }
+
+    renderTargetAcquired = true;
+    presentedFrame       = nullptr;
+}
+
+void Rasterizer::shadeVisibilityBuffer()
+{
+    // Only the pixels inside the viewport are shaded (the pixels outside the viewport may belong to another pass).
+    const RectI rect    = getViewportRect();
+    const int   samples = multisampling ? NumSamples : 1;
+
+    Image& colorTarget = getColorTarget();
+
+    std::size_t shaded = 0u;
+
+    // Shade every pixel of the visibility buffer exactly once for each triangle that is visible in the pixel.
+#pragma omp parallel for schedule( dynamic ) reduction( + : shaded )
+    for ( int y = rect.top; y < rect.top + rect.height; ++y )
+    {
+        const std::uint64_t* visibilityRow = &visibilityBuffer( 0, y );
+        Color*               colorRow      = multisampling ? &colorSamples( 0, y ) : &colorTarget( 0, y );
+
+        for ( int i = rect.left * samples; i < ( rect.left + rect.width ) * samples; ++i )
+        {
+            const std::uint64_t id = visibilityRow[i];
+            if ( id == InvalidVisibilityId )
+                continue;
+
+            // With multisampling, reuse the color of a previous sample of the pixel that is covered by the same triangle.
+            const int firstSample = i - i % samples;
+            int       sample      = firstSample;
+            while ( sample < i && visibilityRow[sample] != id )
+                ++sample;
+
+            if ( sample < i )
+            {
+                colorRow[i] = colorRow[sample];
+                continue;
+            }
+
+            const auto drawId     = static_cast<std::uint32_t>( id >> 32 );
+            const auto triangleId = static_cast<std::uint32_t>( id );
+
+            const DrawCommand& command = frameCommands[drawId];
+            const Triangle&    tri     = frameTriangles[drawId][triangleId];
+
+            // The pixel is shaded at its center.
+            const int x = i / samples;
+
+            const float fx = static_cast<float>( x - tri.minX );
+            const float fy = static_cast<float>( y - tri.minY );
+
+            // The alpha test was already performed when the visibility buffer was written.
+            if ( command.diffuseTexture )
+            {
+                const TexCoords tc = interpolateTexCoords( tri, fx, fy );
+
+                colorRow[i] = sampler.sample( *command.diffuseTexture, tc.uv, sampler.getLOD( *command.diffuseTexture, tc.ddx, tc.ddy ) );
+            }
+            else
+            {
+                colorRow[i] = command.diffuseColor;
+            }
+
+            if ( command.shadows && shadowMap )
+                colorRow[i] = applyShadow( colorRow[i], tri, fx, fy, 1.0f / tri.invW( fx, fy ) );
+
+            ++shaded;
+        }
+    }
+
+    statistics.fragmentsShaded += shaded;
+}
+
+void Rasterizer::resolveSamples()
+{
+    static_assert( NumSamples == 4, "The resolve assumes 4 samples per pixel." );
+
+    // Only the pixels inside the viewport are resolved (the pixels outside the viewport may belong to another pass).
+    const RectI rect        = getViewportRect();
+    Image&      colorTarget = getColorTarget();
+
+#pragma omp parallel for schedule( dynamic )
+    for ( int y = rect.top; y < rect.bottom(); ++y )
+    {
+        const Color* sampleRow = &colorSamples( 0, y );
+        Color*       colorRow  = &colorTarget( 0, y );
+
+        const int w = rect.right();
+        int       x = rect.left;
+#if SR_SSE2
+        const __m128i zero  = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16( NumSamples / 2 );
+
+        // Resolve 2 pixels at a time. The color channels are added in 16-bit lanes.
+        for ( ; x + 1 < w; x += 2 )
+        {
+            const __m128i p0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( sampleRow + x * NumSamples ) );
+            const __m128i p1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( sampleRow + ( x + 1 ) * NumSamples ) );
+
+            // (s0 + s2, s1 + s3) of each pixel.
+            const __m128i s0 = _mm_add_epi16( _mm_unpacklo_epi8( p0, zero ), _mm_unpackhi_epi8( p0, zero ) );
+            const __m128i s1 = _mm_add_epi16( _mm_unpacklo_epi8( p1, zero ), _mm_unpackhi_epi8( p1, zero ) );
+
+            // The sum of the samples of both pixels.
+            const __m128i sum = _mm_add_epi16( _mm_unpacklo_epi64( s0, s1 ), _mm_unpackhi_epi64( s0, s1 ) );
+            const __m128i avg = _mm_srli_epi16( _mm_add_epi16( sum, round ), 2 );
+
+            _mm_storel_epi64( reinterpret_cast<__m128i*>( colorRow + x ), _mm_packus_epi16( avg, avg ) );
+        }
+#endif
+        for ( ; x < w; ++x )
+        {
+            const Color* s = sampleRow + x * NumSamples;
+
+            colorRow[x] = Color {
+                static_cast<uint8_t>( ( s[0].r + s[1].r + s[2].r + s[3].r + 2u ) / 4u ),
+                static_cast<uint8_t>( ( s[0].g + s[1].g + s[2].g + s[3].g + 2u ) / 4u ),
+                static_cast<uint8_t>( ( s[0].b + s[1].b + s[2].b + s[3].b + 2u ) / 4u ),
+                static_cast<uint8_t>( ( s[0].a + s[1].a + s[2].a + s[3].a + 2u ) / 4u )
+            };
+        }
+    }
+}
+
+void Rasterizer::processDrawCommand( const DrawCommand& command, std::uint32_t drawId, std::vector<VertexOutput>& vertices, std::vector<Triangle>& out, Statistics& stats ) const
+{
+    const Mesh&      mesh        = *command.mesh;
+    const glm::mat4& modelMatrix = command.modelMatrix;
+
+    // The start of the current stage. Culling the mesh and its meshlets is part of the clip stage.
+    auto stageStart = Clock::now();
+
+    out.clear();
+
+    glm::mat4 modelViewProjectionMatrix = modelMatrix;
+    glm::mat4 modelViewMatrix           = modelMatrix;
+    if ( camera )
+    {
+        modelViewMatrix           = camera->getViewMatrix() * modelMatrix;
+        modelViewProjectionMatrix = camera->getViewProjectionMatrix() * modelMatrix;
+    }
+
+    // View frustum culling.
+    // The frustum planes are extracted from the model-view-projection matrix,
+    // so the planes are in object space and can be tested against the AABB of the mesh.
+    const Frustum     frustum( modelViewProjectionMatrix );
+    const Containment containment = frustum.contains( mesh.getAABB() );
+    if ( containment == Containment::Outside )
+    {
+        ++stats.meshesCulled;
+        stats.clipTime += elapsedMilliseconds( stageStart );
+        return;
+    }
+
+    // Occlusion culling.
+    if ( occlusionCuller && occlusionCuller->isOccluded( mesh.getAABB(), modelMatrix ) )
+    {
+        ++stats.meshesOccluded;
+        stats.clipTime += elapsedMilliseconds( stageStart );
+        return;
+    }
+
+    ++stats.meshesDrawn;
+
+    // Triangles of a mesh that is completely inside the view frustum don't need to be clipped.
+    if ( containment == Containment::Inside )
+        ++stats.meshesInside;
+
+    // Mesh must be triangulated.
+    // TODO: Topology?
+    assert( mesh.getNumIndices() % 3 == 0 );
+
+    // Meshlet culling.
+    // The meshlets of the mesh are culled against the view frustum, the occluders, and their normal cones
+    // before any of their vertices are transformed.
+    // The normal cone test is done in object space, so it is only used if the model-view matrix
+    // doesn't mirror the mesh (which swaps the front and back faces).
+    const bool coneCulling = camera && glm::determinant( glm::mat3 { modelViewMatrix } ) > 0.0f;
+    const bool perspective = camera && camera->getProjectionMatrix()[2][3] != 0.0f;
+
+    glm::vec3 eye { 0.0f };      // The camera position in object space (perspective projection).
+    glm::vec3 viewDir { 0.0f };  // The view direction in object space (orthographic projection).
+    if ( coneCulling )
+    {
+        const glm::mat4 invModelViewMatrix = glm::inverse( modelViewMatrix );
+
+        eye     = invModelViewMatrix[3];
+        viewDir = glm::normalize( glm::vec3 { invModelViewMatrix * glm::vec4 { 0.0f, 0.0f, -1.0f, 0.0f } } );
+    }
+
+    struct VisibleMeshlet
+    {
+        const Mesh::Meshlet* meshlet;
+        bool                 clip;
+    };
+
+    const std::vector<Mesh::Meshlet>& meshlets = mesh.getMeshlets();
+
+    std::vector<VisibleMeshlet> visibleMeshlets;
+    visibleMeshlets.reserve( meshlets.size() );
+
+    // The mesh is already tested against the occluders, so only test the meshlets of meshes that have more than one.
+    const bool occlusionCulling = occlusionCuller && meshlets.size() > 1;
+
+    for ( const Mesh::Meshlet& meshlet: meshlets )
+    {
+        // Backface culling: all triangles of the meshlet face away from the camera if the direction from the
+        // camera to every point of the bounding sphere is inside the normal cone (expanded by 90 degrees).
+        // Source: Arseny Kapoulkine, "meshoptimizer" (https://github.com/zeux/meshoptimizer).
+        if ( coneCulling && meshlet.coneCutoff < 1.0f )
+        {
+            bool backfacing;
+            if ( perspective )
+            {
+                const glm::vec3 v = meshlet.sphere.center - eye;
+                backfacing        = glm::dot( v, meshlet.coneAxis ) >= meshlet.coneCutoff * ( glm::length( v ) + meshlet.sphere.radius ) + meshlet.sphere.radius;
+            }
+            else
+            {
+                backfacing = glm::dot( viewDir, meshlet.coneAxis ) >= meshlet.coneCutoff;
+            }
+
+            if ( backfacing )
+            {
+                ++stats.meshletsCulled;
+                continue;
+            }
+        }
+
+        const Containment meshletContainment = containment == Containment::Inside ? Containment::Inside : frustum.contains( meshlet.aabb );
+        if ( meshletContainment == Containment::Outside )
+        {
+            ++stats.meshletsCulled;
+            continue;
+        }
+
+        if ( occlusionCulling && occlusionCuller->isOccluded( meshlet.aabb, modelMatrix ) )
+        {
+            ++stats.meshletsCulled;
+            continue;
+        }
+
+        visibleMeshlets.push_back( { &meshlet, meshletContainment != Containment::Inside } );
+    }
+
+    stats.meshletsDrawn += visibleMeshlets.size();
+    stats.clipTime += elapsedMilliseconds( stageStart );
+
+    stageStart = Clock::now();
+
+    // Transform the vertices of the visible meshlets.
+    // The vertices of a meshlet are mostly close together in the vertex buffer, so the batches of VertexBatchSize vertices
+    // that are used by the visible meshlets are marked, and consecutive batches are transformed together.
+    const int* indices     = mesh.getIndices().data();
+    const int  numVertices = static_cast<int>( mesh.getPositions().size() );
+    const int  numBatches  = ( numVertices + VertexBatchSize - 1 ) / VertexBatchSize;
+
+    std::vector<bool> batches( numBatches, visibleMeshlets.size() == meshlets.size() );
+    if ( visibleMeshlets.size() < meshlets.size() )
+    {
+        for ( const VisibleMeshlet& visibleMeshlet: visibleMeshlets )
+        {
+            const Mesh::Meshlet& meshlet = *visibleMeshlet.meshlet;
+            for ( std::uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i )
+                batches[indices[i] / VertexBatchSize] = true;
+        }
+    }
+
+    vertices.resize( numVertices );
+    for ( int batch = 0; batch < numBatches; )
+    {
+        if ( !batches[batch] )
+        {
+            ++batch;
+            continue;
+        }
+
+        const int firstBatch = batch;
+        while ( batch < numBatches && batches[batch] )
+            ++batch;
+
+        const int firstVertex = firstBatch * VertexBatchSize;
+        const int lastVertex  = std::min( batch * VertexBatchSize, numVertices );
+
+        transformVertices( mesh, modelMatrix, modelViewMatrix, modelViewProjectionMatrix, vertices, firstVertex, lastVertex );
+        stats.verticesShaded += lastVertex - firstVertex;
+    }
+
+    stats.vertexTime += elapsedMilliseconds( stageStart );
+
+    // Clip and setup the triangles of the visible meshlets.
+    // The texture coordinates are only interpolated for textured triangles.
+    const bool texCoords = command.alphaTexture || command.diffuseTexture;
+
+    const auto setup = [&]( const VertexOutput tri[3] ) {
+        Triangle t;
+        if ( setupTriangle( tri, t, texCoords, command.shadows ) )
+        {
+            t.drawId     = drawId;
+            t.triangleId = static_cast<std::uint32_t>( out.size() );
+            out.push_back( t );
+        }
+        else
+        {
+            ++stats.trianglesCulled;
+        }
+    };
+
+    out.reserve( mesh.getNumIndices() / 3 );
+
+    // The triangles of a meshlet after clipping (3 vertices per triangle).
+    // The triangles of a meshlet are clipped before they are set up, so the time of both stages can be measured.
+    std::vector<VertexOutput> clipped;
+    double                    clipTime = 0.0;
+
+    stageStart = Clock::now();
+
+    for ( const VisibleMeshlet& visibleMeshlet: visibleMeshlets )
+    {
+        const Mesh::Meshlet& meshlet   = *visibleMeshlet.meshlet;
+        const std::uint32_t  lastIndex = meshlet.firstIndex + meshlet.indexCount;
+
+        stats.trianglesSubmitted += meshlet.indexCount / 3;
+
+        if ( !visibleMeshlet.clip )
+        {
+            for ( std::uint32_t i = meshlet.firstIndex; i < lastIndex; i += 3 )
+            {
+                const VertexOutput tri[] = { vertices[indices[i + 0]], vertices[indices[i + 1]], vertices[indices[i + 2]] };
+                setup( tri );
+            }
+
+            continue;
+        }
+
+        const auto clipStart = Clock::now();
+
+        clipped.clear();
+        for ( std::uint32_t i = meshlet.firstIndex; i < lastIndex; i += 3 )
+        {
+            const VertexOutput tri[] = { vertices[indices[i + 0]], vertices[indices[i + 1]], vertices[indices[i + 2]] };
+
+            VertexOutput polygon[MaxClippedVertices];
+            const int    n_out = clipTriangle( tri, polygon );
+
+            if ( n_out == 0 )
+                ++stats.trianglesCulled;
+
+            // Triangulate the clipped polygon as a triangle fan.
+            for ( int j = 1; j + 1 < n_out; ++j )
+            {
+                clipped.push_back( polygon[0] );
+                clipped.push_back( polygon[j] );
+                clipped.push_back( polygon[j + 1] );
+            }
+        }
+
+        stats.trianglesClipped += meshlet.indexCount / 3;
+        clipTime += elapsedMilliseconds( clipStart );
+
+        for ( std::size_t i = 0; i < clipped.size(); i += 3 )
+            setup( &clipped[i] );
+    }
+
+    stats.trianglesRasterized += out.size();
+    stats.clipTime += clipTime;
+    stats.setupTime += elapsedMilliseconds( stageStart ) - clipTime;
+}
+
+void Rasterizer::rasterizeTriangles()
+{
+    // The viewport may extend past the render target, so only the pixels of the viewport inside the render target are rasterized.
+    const RectI rect         = getViewportRect();
+    AABB        viewportAABB = AABB::fromMinMax( { rect.left, rect.top, viewport.minDepth }, { rect.left + rect.width - 1, rect.top + rect.height - 1, viewport.maxDepth } );
+
+    if ( rasterMode == RasterMode::Immediate || tileBins.empty() )
+    {
+        if ( depthPrePass )
+        {
+            // With a depth pre-pass, the depth of all triangles is rasterized before the triangles are shaded.
+            for ( const Triangle& t: triangles )
+            {
+                const DrawCommand& command = commands[t.drawId];
+                rasterize( t, viewportAABB, command.depthKernel, command, statistics );
+            }
+        }
+
+        for ( const Triangle& t: triangles )
+        {
+            const DrawCommand& command = commands[t.drawId];
+            rasterize( t, viewportAABB, command.shadeKernel, command, statistics );
+        }
+
+        return;
+    }
+
+    // Sort-middle: bin the triangles into the screen tiles they overlap.
+    // Triangles are binned in submission order so the order within a tile matches the immediate mode.
+    for ( std::size_t i = 0; i < triangles.size(); ++i )
+    {
+        const Triangle& t = triangles[i];
+
+        const int minX = std::max( t.minX, static_cast<int>( viewportAABB.min.x ) );
+        const int minY = std::max( t.minY, static_cast<int>( viewportAABB.min.y ) );
+        const int maxX = std::min( t.maxX, static_cast<int>( viewportAABB.max.x ) );
+        const int maxY = std::min( t.maxY, static_cast<int>( viewportAABB.max.y ) );
+
+        if ( minX > maxX || minY > maxY )
+            continue;
+
+        const int tx0 = minX / TileSize;
+        const int ty0 = minY / TileSize;
+        const int tx1 = std::min( maxX / TileSize, numTilesX - 1 );
+        const int ty1 = std::min( maxY / TileSize, numTilesY - 1 );
+
+        for ( int ty = ty0; ty <= ty1; ++ty )
+        {
+            for ( int tx = tx0; tx <= tx1; ++tx )
+            {
+                tileBins[static_cast<std::size_t>( ty ) * numTilesX + tx].push_back( static_cast<std::uint32_t>( i ) );
+            }
+        }
+    }
+
+    // Rasterize the tiles in parallel.
+    // Each tile only writes to its own region of the color and depth buffers, so no synchronization is required.
+    // The statistics are also accumulated per tile.
+    const int numTiles = numTilesX * numTilesY;
+
+    tileStatistics.assign( numTiles, {} );
+
+#pragma omp parallel for schedule( dynamic ) firstprivate( viewportAABB )
+    for ( int i = 0; i < numTiles; ++i )
+    {
+        auto& bin = tileBins[i];
+        if ( bin.empty() )
+            continue;
+
+        const int tx = i % numTilesX;
+        const int ty = i / numTilesX;
+
+        AABB tileAABB = AABB::fromMinMax( { tx * TileSize, ty * TileSize, 0 }, { tx * TileSize + TileSize - 1, ty * TileSize + TileSize - 1, 0 } );
+        tileAABB.clamp( viewportAABB );
+
+        if ( depthPrePass )
+        {
+            for ( std::uint32_t t: bin )
+            {
+                const Triangle&    tri     = triangles[t];
+                const DrawCommand& command = commands[tri.drawId];
+                rasterize( tri, tileAABB, command.depthKernel, command, tileStatistics[i] );
+            }
+        }
+
+        for ( std::uint32_t t: bin )
+        {
+            const Triangle&    tri     = triangles[t];
+            const DrawCommand& command = commands[tri.drawId];
+            rasterize( tri, tileAABB, command.shadeKernel, command, tileStatistics[i] );
+        }
+
+        bin.clear();
+    }
+
+    for ( const Statistics& stats: tileStatistics )
+        statistics += stats;
+}
+
+bool Rasterizer::setupTriangle( const VertexOutput in[3], Triangle& out, bool texCoords, bool shadows ) const noexcept
+{
+    // Fixed-point screen-space vertex positions.
+    std::int64_t X[3], Y[3];
+    // Screen-space depth and 1/w of the vertices.
+    float Z[3], invW[3];
+
+    for ( int i = 0; i < 3; ++i )
+    {
+        glm::vec4 pos = in[i].position;
+
+        // Store 1/w before perspective divide.
+        invW[i] = 1.0f / pos.w;
+
+        pos = pos / pos.w;  // Perspective divide.
+
+        // NDC -> screen space
+        pos   = pos * 0.5f + 0.5f;
+        pos.x = pos.x * viewport.width + viewport.x;
+        pos.y = ( 1.0f - pos.y ) * viewport.height + viewport.y;  // Flip Y
+        Z[i]  = pos.z;
+
+        // Reject triangles that can't be represented in the fixed-point edge equations.
+        // This also rejects NaN coordinates.
+        if ( !( std::abs( pos.x ) < MaxScreenCoord && std::abs( pos.y ) < MaxScreenCoord ) )
+            return false;
+
+        // Snap to the sub-pixel grid.
+        X[i] = static_cast<std::int64_t>( std::floor( pos.x * static_cast<float>( SubPixelSteps ) + 0.5f ) );
+        Y[i] = static_cast<std::int64_t>( std::floor( pos.y * static_cast<float>( SubPixelSteps ) + 0.5f ) );
+    }
+
+    // Compute the edge equations. Edge i is opposite to vertex i.
+    // Source: Juan Pineda, "A Parallel Algorithm for Polygon Rasterization", 1988.
+    for ( int i = 0; i < 3; ++i )
+    {
+        const int j = ( i + 1 ) % 3;
+        const int k = ( i + 2 ) % 3;
+
+        Edge& e = out.e[i];
+        e.a     = Y[k] - Y[j];
+        e.b     = X[j] - X[k];
+        e.c     = -( e.a * X[j] + e.b * Y[j] );
+
+        // Top-left fill rule: pixels exactly on an edge are only
+        // rasterized if the edge is a left edge, or a top edge.
+        // Source: https://learn.microsoft.com/en-us/windows/win32/direct3d11/d3d10-graphics-programming-guide-rasterizer-stage-rules
+        const bool isLeft = e.a > 0;
+        const bool isTop  = e.a == 0 && e.b > 0;
+        e.bias            = isLeft || isTop ? 0 : -1;
+        e.c += e.bias;
+    }
+
+    // Backface culling.
+    // Twice the signed area of the triangle in sub-pixel units is the value of
+    // edge equation 0 at vertex 0. Front facing triangles have a positive area
+    // (clockwise in screen space after flipping the Y axis).
+    const std::int64_t area = out.e[0].a * X[0] + out.e[0].b * Y[0] + out.e[0].c - out.e[0].bias;
+    if ( area <= 0 )
+        return false;
+
+    const float invArea = 1.0f / static_cast<float>( area );
+
+    // Inclusive pixel bounding box.
+    out.minX = static_cast<int>( std::min( { X[0], X[1], X[2] } ) >> SubPixelBits );
+    out.minY = static_cast<int>( std::min( { Y[0], Y[1], Y[2] } ) >> SubPixelBits );
+    out.maxX = static_cast<int>( std::max( { X[0], X[1], X[2] } ) >> SubPixelBits );
+    out.maxY = static_cast<int>( std::max( { Y[0], Y[1], Y[2] } ) >> SubPixelBits );
+
+    // The barycentric coordinates at the center of the first pixel of the bounding box
+    // (without the fill rule bias), and their increments for one pixel step in x and y.
+    const std::int64_t px = static_cast<std::int64_t>( out.minX ) * SubPixelSteps + SubPixelSteps / 2;
+    const std::int64_t py = static_cast<std::int64_t>( out.minY ) * SubPixelSteps + SubPixelSteps / 2;
+
+    float b[3], bdx[3], bdy[3];
+    for ( int i = 0; i < 3; ++i )
+    {
+        const Edge& e = out.e[i];
+        b[i]          = static_cast<float>( e.a * px + e.b * py + e.c - e.bias ) * invArea;
+        bdx[i]        = static_cast<float>( e.a * SubPixelSteps ) * invArea;
+        bdy[i]        = static_cast<float>( e.b * SubPixelSteps ) * invArea;
+    }
+
+    // Attributes are linear in screen space, so they are interpolated with plane equations.
+    const auto plane = [&]( float a0, float a1, float a2 ) {
+        return Interpolant {
+            a0 * b[0] + a1 * b[1] + a2 * b[2],
+            a0 * bdx[0] + a1 * bdx[1] + a2 * bdx[2],
+            a0 * bdy[0] + a1 * bdy[1] + a2 * bdy[2]
+        };
+    };
+
+    out.z    = plane( Z[0], Z[1], Z[2] );
+    out.minZ = std::min( { Z[0], Z[1], Z[2] } );
+    out.maxZ = std::max( { Z[0], Z[1], Z[2] } );
+
+    // Only set up the attributes that are interpolated.
+    // The texture coordinates and the light-space position are divided by w for perspective correct interpolation.
+    if ( texCoords || shadows )
+        out.invW = plane( invW[0], invW[1], invW[2] );
+
+    if ( texCoords )
+    {
+        out.u = plane( in[0].uv.x * invW[0], in[1].uv.x * invW[1], in[2].uv.x * invW[2] );
+        out.v = plane( in[0].uv.y * invW[0], in[1].uv.y * invW[1], in[2].uv.y * invW[2] );
+    }
+
+    if ( shadows )
+    {
+        out.lx = plane( in[0].lightPosition.x * invW[0], in[1].lightPosition.x * invW[1], in[2].lightPosition.x * invW[2] );
+        out.ly = plane( in[0].lightPosition.y * invW[0], in[1].lightPosition.y * invW[1], in[2].lightPosition.y * invW[2] );
+        out.lz = plane( in[0].lightPosition.z * invW[0], in[1].lightPosition.z * invW[1], in[2].lightPosition.z * invW[2] );
+    }
+
+    return true;
+}
+
+Rasterizer::Kernel Rasterizer::getKernel( const PipelineState& state ) noexcept
+{
+    // The kernels of a pipeline state.
+    // With multisampling, the same kernel rasterizes triangles of all sizes.
+    constexpr auto makeKernel = []<PipelineState State>() {
+        if constexpr ( State.multisample )
+            return Kernel { &Rasterizer::rasterizeSamples<State>, &Rasterizer::rasterizeSamples<State> };
+        else
+            return Kernel { &Rasterizer::rasterizeBlocks<State>, &Rasterizer::rasterizePixels<State> };
+    };
+
+    // The kernels of all pipeline states, compiled ahead of time.
+    static constexpr auto kernels = [&makeKernel]<std::size_t... I>( std::index_sequence<I...> ) {
+        return std::array<Kernel, sizeof...( I )> {
+            makeKernel.template operator()<makePipelineState( I )>()...
+        };
+    }( std::make_index_sequence<NumPipelineStates> {} );
+
+    return kernels[pipelineStateIndex( state )];
+}
+
+void Rasterizer::rasterize( const Triangle& tri, const AABB& bounds, const Kernel& kernel, const DrawCommand& command, Statistics& stats )
+{
+    // Clamp the triangle's bounding box to the rasterization bounds.
+    const int minX = std::max( tri.minX, static_cast<int>( bounds.min.x ) );
+    const int minY = std::max( tri.minY, static_cast<int>( bounds.min.y ) );
+    const int maxX = std::min( tri.maxX, static_cast<int>( bounds.max.x ) );
+    const int maxY = std::min( tri.maxY, static_cast<int>( bounds.max.y ) );
+
+    if ( minX > maxX || minY > maxY )
+        return;
+
+    // Rasterizing in blocks requires the edge equations of a partially covered block to fit in 32-bit integers.
+    bool useBlocks = true;
+    for ( const Edge& e: tri.e )
+        useBlocks = useBlocks && std::abs( e.a ) <= MaxBlockEdgeCoefficient && std::abs( e.b ) <= MaxBlockEdgeCoefficient;
+
+    ( this->*( useBlocks ? kernel.blocks : kernel.pixels ) )( tri, minX, minY, maxX, maxY, command, stats );
+}
+
+template<Rasterizer::PipelineState State>
+void Rasterizer::rasterizeBlocks( const Triangle& tri, int minX, int minY, int maxX, int maxY, const DrawCommand& command, Statistics& stats )
+{
+    using Depth = DepthTraits<State.depthFormat>;
+
+    // After a depth pre-pass, the depth buffer contains the depth of the visible fragments.
+    // The shading pass only needs to test for equal depth and doesn't need to update the depth buffer.
+    constexpr bool depthEqual = State.pass == RasterPass::ShadeEqual;
+    constexpr bool depthOnly  = State.pass == RasterPass::Depth;
+
+    // The number of fragments that were depth tested, passed the depth test, were written, and were shaded.
+    std::size_t pixelsTested  = 0u;
+    std::size_t pixelsPassed  = 0u;
+    std::size_t pixelsWritten = 0u;
+    std::size_t shaded        = 0u;
+
+    const Edge* e = tri.e;
+
+    // Edge equation increments for one pixel step in x and y.
+    std::int64_t stepX[3], stepY[3];
+    // The offset from the value of an edge equation at the first pixel of a block to its minimum and maximum value in the block.
+    std::int64_t minOffset[3], maxOffset[3];
+
+    for ( int i = 0; i < 3; ++i )
+    {
+        stepX[i]     = e[i].a * SubPixelSteps;
+        stepY[i]     = e[i].b * SubPixelSteps;
+        minOffset[i] = ( std::min<std::int64_t>( stepX[i], 0 ) + std::min<std::int64_t>( stepY[i], 0 ) ) * ( BlockSize - 1 );
+        maxOffset[i] = ( std::max<std::int64_t>( stepX[i], 0 ) + std::max<std::int64_t>( stepY[i], 0 ) ) * ( BlockSize - 1 );
+    }
+
+    // Blocks are aligned to the block grid. Since the tile size is a multiple of the block size,
+    // a block never overlaps more than one tile.
+    const int blockMinX = minX & ~( BlockSize - 1 );
+    const int blockMinY = minY & ~( BlockSize - 1 );
+
+    // Evaluate the edge equations at the center of the first pixel of the first block.
+    const std::int64_t px = static_cast<std::int64_t>( blockMinX ) * SubPixelSteps + SubPixelSteps / 2;
+    const std::int64_t py = static_cast<std::int64_t>( blockMinY ) * SubPixelSteps + SubPixelSteps / 2;
+
+    std::int64_t blockRow[3];
+    for ( int i = 0; i < 3; ++i )
+        blockRow[i] = e[i].a * px + e[i].b * py + e[i].c;
+
+    // The offset from the depth at the first pixel of a block to the minimum depth in the block.
+    const float minZOffset = ( std::min( tri.z.dx, 0.0f ) + std::min( tri.z.dy, 0.0f ) ) * ( BlockSize - 1 );
+
+#if SR_SSE2
+    using DepthType = typename Depth::Type;
+
+    // The offset from the depth at the first pixel of a block to the maximum depth in the block.
+    const float maxZOffset = ( std::max( tri.z.dx, 0.0f ) + std::max( tri.z.dy, 0.0f ) ) * ( BlockSize - 1 );
+
+    auto&      depthTarget = getDepthTarget<State.depthFormat>();
+    DepthType* depthData   = depthTarget.data();
+    Color*     colorData   = getColorTarget().data();
+    const auto stride      = depthTarget.getWidth();
+    const auto colorStride = getColorTarget().getWidth();
+
+    // With a visibility buffer, the visibility ID is written instead of the color.
+    std::uint64_t*      visibilityData = State.visibilityBuffer ? visibilityBuffer.data() : nullptr;
+    const std::uint64_t visibilityId   = makeVisibilityId( tri );
+
+    // The pixel offsets of the 4 lanes.
+    const __m128i laneIndex = _mm_set_epi32( 3, 2, 1, 0 );
+    const __m128  laneX     = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+
+    // Per lane increments of the edge equations.
+    __m128i laneStepI[3];
+    for ( int i = 0; i < 3; ++i )
+    {
+        const auto s = static_cast<int>( stepX[i] );
+        laneStepI[i] = _mm_set_epi32( s * 3, s * 2, s, 0 );
+    }
+
+    // Per lane increments of the interpolated attributes.
+    const __m128 zStep    = _mm_mul_ps( _mm_set1_ps( tri.z.dx ), laneX );
+    const __m128 invWStep = State.perspective() ? _mm_mul_ps( _mm_set1_ps( tri.invW.dx ), laneX ) : _mm_setzero_ps();
+    const __m128 uStep    = State.texCoords() ? _mm_mul_ps( _mm_set1_ps( tri.u.dx ), laneX ) : _mm_setzero_ps();
+    const __m128 vStep    = State.texCoords() ? _mm_mul_ps( _mm_set1_ps( tri.v.dx ), laneX ) : _mm_setzero_ps();
+    const __m128 invWdx   = _mm_set1_ps( State.texCoords() ? tri.invW.dx : 0.0f );
+    const __m128 invWdy   = _mm_set1_ps( State.texCoords() ? tri.invW.dy : 0.0f );
+    const __m128 one      = _mm_set1_ps( 1.0f );
+    const __m128i color   = _mm_set1_epi32( static_cast<int>( std::bit_cast<std::uint32_t>( command.diffuseColor ) ) );
+#endif
+
+    for ( int by = blockMinY; by <= maxY; by += BlockSize )
+    {
+        const int y0 = std::max( by, minY );
+        const int y1 = std::min( by + BlockSize - 1, maxY );
+
+        for ( int bx = blockMinX; bx <= maxX; bx += BlockSize )
+        {
+            const int x0 = std::max( bx, minX );
+            const int x1 = std::min( bx + BlockSize - 1, maxX );
+
+            // Edge equations at the first pixel of the block.
+            std::int64_t w[3];
+            for ( int i = 0; i < 3; ++i )
+                w[i] = blockRow[i] + stepX[i] * ( bx - blockMinX );
+
+            // Trivial reject: the block is completely outside of one of the edges.
+            if ( w[0] + maxOffset[0] < 0 || w[1] + maxOffset[1] < 0 || w[2] + maxOffset[2] < 0 )
+                continue;
+
+            // Only the edges that cross the block need to be tested per pixel.
+            // If no edge crosses the block, it is completely inside the triangle (trivial accept).
+            int partialEdges = 0;
+            for ( int i = 0; i < 3; ++i )
+            {
+                if ( w[i] + minOffset[i] < 0 )
+                    partialEdges |= 1 << i;
+            }
+
+            // Hierarchical depth test: reject the block if the nearest depth of the triangle
+            // in the block is behind the farthest depth in the depth buffer.
+            // The depth of the triangle is also bounded by the depth of its vertices.
+            const int   blockX    = bx / BlockSize;
+            const int   blockY    = by / BlockSize;
+            const float blockZ    = tri.z( static_cast<float>( bx - tri.minX ), static_cast<float>( by - tri.minY ) );
+            const float blockMinZ = std::max( blockZ + minZOffset, tri.minZ );
+
+            if ( depthEqual ? blockMinZ > hiZMax( blockX, blockY ) + Depth::Tolerance : blockMinZ >= hiZMax( blockX, blockY ) )
+                continue;
+
+#if SR_SSE2
+            // If the triangle covers the whole block and is in front of the nearest depth in the depth buffer,
+            // all pixels pass the depth test and the depth buffer doesn't need to be read.
+            const float blockMaxZ   = std::min( blockZ + maxZOffset, tri.maxZ );
+            const bool  depthAccept = !depthEqual && partialEdges == 0 && blockMaxZ < hiZMin( blockX, blockY );
+#endif
+            // Set if the depth of any fragment in the block was written.
+            bool written = false;
+
+            for ( int y = y0; y <= y1; ++y )
+            {
+                // Edge equations at the first pixel of the row.
+                std::int64_t row[3];
+                for ( int i = 0; i < 3; ++i )
+                    row[i] = w[i] + stepY[i] * ( y - by );
+
+#if SR_SSE2
+                DepthType*     depthRow      = depthData + static_cast<std::size_t>( y ) * stride;
+                Color*         colorRow      = colorData + static_cast<std::size_t>( y ) * colorStride;
+                std::uint64_t* visibilityRow = visibilityData ? visibilityData + static_cast<std::size_t>( y ) * stride : nullptr;
+
+                // The offset of the row from the origin of the plane equations.
+                const float fy = static_cast<float>( y - tri.minY );
+
+                // Process the row of the block 4 pixels at a time.
+                for ( int l = 0; l < BlockSize; l += 4 )
+                {
+                    const int x = bx + l;
+                    if ( x > x1 || x + 3 < x0 )
+                        continue;
+
+                    // Mask out the pixels outside of the rasterization bounds.
+                    const bool full   = x >= x0 && x + 3 <= x1;
+                    __m128     inside = _mm_castsi128_ps( _mm_cmpeq_epi32( laneIndex, laneIndex ) );
+                    if ( !full )
+                        inside = _mm_castsi128_ps( _mm_and_si128( _mm_cmpgt_epi32( laneIndex, _mm_set1_epi32( x0 - x - 1 ) ), _mm_cmplt_epi32( laneIndex, _mm_set1_epi32( x1 - x + 1 ) ) ) );
+
+                    // Coverage test for the edges that cross the block.
+                    if ( partialEdges )
+                    {
+                        __m128i edges = _mm_setzero_si128();
+                        for ( int i = 0; i < 3; ++i )
+                        {
+                            if ( partialEdges & ( 1 << i ) )
+                                edges = _mm_or_si128( edges, _mm_add_epi32( _mm_set1_epi32( static_cast<int>( row[i] + stepX[i] * l ) ), laneStepI[i] ) );
+                        }
+                        // The sign bit is set if the pixel is outside one of the edges.
+                        inside = _mm_andnot_ps( _mm_castsi128_ps( _mm_srai_epi32( edges, 31 ) ), inside );
+                    }
+
+                    const int insideMask = _mm_movemask_ps( inside );
+                    if ( insideMask == 0 )
+                        continue;
+
+                    pixelsTested += std::popcount( static_cast<unsigned>( insideMask ) );
+
+                    const float fx = static_cast<float>( x - tri.minX );
+
+                    // Depth test.
+                    const __m128 z = Depth::encode( _mm_add_ps( _mm_set1_ps( tri.z( fx, fy ) ), zStep ) );
+
+                    __m128 depth;
+                    if ( depthAccept )
+                    {
+                        depth = z;
+                    }
+                    else if ( full )
+                    {
+                        depth = Depth::load( depthRow + x );
+                    }
+                    else
+                    {
+                        alignas( 16 ) DepthType d[4];
+                        for ( int i = 0; i < 4; ++i )
+                            d[i] = x + i >= x0 && x + i <= x1 ? depthRow[x + i] : DepthType { 0 };
+                        depth = Depth::load( d );
+                    }
+
+                    const __m128 pass = depthAccept ? inside : _mm_and_ps( depthEqual ? Depth::equal( z, depth ) : Depth::less( z, depth ), inside );
+                    int          mask = _mm_movemask_ps( pass );
+                    if ( mask == 0 )
+                        continue;
+
+                    pixelsPassed += std::popcount( static_cast<unsigned>( mask ) );
+
+                    if constexpr ( !depthEqual )
+                        written = true;
+
+                    if constexpr ( !depthOnly )
+                        shaded += std::popcount( static_cast<unsigned>( mask ) );
+
+                    alignas( 16 ) DepthType zs[4];
+                    Depth::store( zs, z );
+
+                    if constexpr ( !State.perspective() )
+                    {
+                        // Without an alpha test, every fragment that passes the depth test is written.
+                        pixelsWritten += std::popcount( static_cast<unsigned>( mask ) );
+
+                        if constexpr ( !depthEqual )
+                        {
+                            if ( full )
+                            {
+                                Depth::store( depthRow + x, _mm_or_ps( _mm_and_ps( pass, z ), _mm_andnot_ps( pass, depth ) ) );
+                            }
+                            else
+                            {
+                                for ( int m = mask; m; m &= m - 1 )
+                                {
+                                    const int i     = std::countr_zero( static_cast<unsigned>( m ) );
+                                    depthRow[x + i] = zs[i];
+                                }
+                            }
+                        }
+
+                        if constexpr ( State.visibilityBuffer )
+                        {
+                            // Shading is deferred to the resolve pass.
+                            for ( ; mask; mask &= mask - 1 )
+                                visibilityRow[x + std::countr_zero( static_cast<unsigned>( mask ) )] = visibilityId;
+                        }
+                        else if constexpr ( !depthOnly )
+                        {
+                            if ( full )
+                            {
+                                const __m128i passI = _mm_castps_si128( pass );
+                                const __m128i dst   = _mm_loadu_si128( reinterpret_cast<const __m128i*>( colorRow + x ) );
+                                _mm_storeu_si128( reinterpret_cast<__m128i*>( colorRow + x ), _mm_or_si128( _mm_and_si128( passI, color ), _mm_andnot_si128( passI, dst ) ) );
+                            }
+                            else
+                            {
+                                for ( ; mask; mask &= mask - 1 )
+                                    colorRow[x + std::countr_zero( static_cast<unsigned>( mask ) )] = command.diffuseColor;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        // Compute the perspective correct texture coordinates and their derivatives (see interpolateTexCoords).
+                        // Source: OpenGL 4.6 Specification, 2022 (pp. 479).
+                        const __m128 correction = _mm_div_ps( one, _mm_add_ps( _mm_set1_ps( tri.invW( fx, fy ) ), invWStep ) );
+
+                        alignas( 16 ) float us[4], vs[4], dudx[4], dvdx[4], dudy[4], dvdy[4], ws[4];
+                        if constexpr ( State.texCoords() )
+                        {
+                            const __m128 u = _mm_mul_ps( _mm_add_ps( _mm_set1_ps( tri.u( fx, fy ) ), uStep ), correction );
+                            const __m128 v = _mm_mul_ps( _mm_add_ps( _mm_set1_ps( tri.v( fx, fy ) ), vStep ), correction );
+
+                            _mm_store_ps( us, u );
+                            _mm_store_ps( vs, v );
+                            _mm_store_ps( dudx, _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( tri.u.dx ), _mm_mul_ps( u, invWdx ) ), correction ) );
+                            _mm_store_ps( dvdx, _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( tri.v.dx ), _mm_mul_ps( v, invWdx ) ), correction ) );
+                            _mm_store_ps( dudy, _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( tri.u.dy ), _mm_mul_ps( u, invWdy ) ), correction ) );
+                            _mm_store_ps( dvdy, _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( tri.v.dy ), _mm_mul_ps( v, invWdy ) ), correction ) );
+                        }
+
+                        if constexpr ( State.shadows )
+                            _mm_store_ps( ws, correction );
+
+                        for ( ; mask; mask &= mask - 1 )
+                        {
+                            const int i = std::countr_zero( static_cast<unsigned>( mask ) );
+
+                            [[maybe_unused]] glm::vec2 uv, ddx, ddy;
+                            if constexpr ( State.texCoords() )
+                            {
+                                uv  = { us[i], vs[i] };
+                                ddx = { dudx[i], dvdx[i] };
+                                ddy = { dudy[i], dvdy[i] };
+                            }
+
+                            // The color and depth are only written if the fragment passes the alpha test.
+                            if constexpr ( State.alphaTest )
+                            {
+                                if ( sampler.sampleNearest( *command.alphaTexture, uv, sampler.getLOD( *command.alphaTexture, ddx, ddy ) ).r == 0 )
+                                    continue;
+                            }
+
+                            ++pixelsWritten;
+
+                            if constexpr ( !depthEqual )
+                                depthRow[x + i] = zs[i];
+
+                            if constexpr ( State.visibilityBuffer )
+                            {
+                                visibilityRow[x + i] = visibilityId;
+                            }
+                            else if constexpr ( !depthOnly )
+                            {
+                                Color c = command.diffuseColor;
+                                if constexpr ( State.diffuseTexture )
+                                    c = sampler.sample( *command.diffuseTexture, uv, sampler.getLOD( *command.diffuseTexture, ddx, ddy ) );
+
+                                if constexpr ( State.shadows )
+                                    c = applyShadow( c, tri, fx + static_cast<float>( i ), fy, ws[i] );
+
+                                colorRow[x + i] = c;
+                            }
+                        }
+                    }
+                }
+#else
+                for ( int x = x0; x <= x1; ++x )
+                {
+                    std::int64_t p[3];
+                    for ( int i = 0; i < 3; ++i )
+                        p[i] = row[i] + stepX[i] * ( x - bx );
+
+                    // Coverage test for the edges that cross the block.
+                    if ( ( ( partialEdges & 1 ) && p[0] < 0 ) || ( ( partialEdges & 2 ) && p[1] < 0 ) || ( ( partialEdges & 4 ) && p[2] < 0 ) )
+                        continue;
+
+                    ++pixelsTested;
+
+                    if ( shadePixel<State>( tri, x, y, command, pixelsWritten ) )
+                    {
+                        ++pixelsPassed;
+                        if constexpr ( !depthOnly )
+                            ++shaded;
+                        if constexpr ( !depthEqual )
+                            written = true;
+                    }
+                }
+#endif
+            }
+
+            if ( written )
+                updateHiZ<State.depthFormat>( blockX, blockY );
+        }
+
+        for ( int i = 0; i < 3; ++i )
+            blockRow[i] += stepY[i] * BlockSize;
+    }
+
+    stats.pixelsTested += pixelsTested;
+    stats.pixelsPassed += pixelsPassed;
+    stats.pixelsWritten += pixelsWritten;
+    stats.fragmentsShaded += shaded;
+}
+
+template<Rasterizer::PipelineState State>
+void Rasterizer::rasterizePixels( const Triangle& tri, int minX, int minY, int maxX, int maxY, const DrawCommand& command, Statistics& stats )
+{
+    // The number of fragments that were depth tested, passed the depth test, were written, and were shaded.
+    std::size_t pixelsTested  = 0u;
+    std::size_t pixelsPassed  = 0u;
+    std::size_t pixelsWritten = 0u;
+    std::size_t shaded        = 0u;
+
+    const Edge* e = tri.e;
+
+    // Evaluate the edge equations at the center of the first pixel.
+    const std::int64_t px = static_cast<std::int64_t>( minX ) * SubPixelSteps + SubPixelSteps / 2;
+    const std::int64_t py = static_cast<std::int64_t>( minY ) * SubPixelSteps + SubPixelSteps / 2;
+
+    std::int64_t row0 = e[0].a * px + e[0].b * py + e[0].c;
+    std::int64_t row1 = e[1].a * px + e[1].b * py + e[1].c;
+    std::int64_t row2 = e[2].a * px + e[2].b * py + e[2].c;
+
+    // Edge equation increments for one pixel step in x and y.
+    const std::int64_t stepX0 = e[0].a * SubPixelSteps;
+    const std::int64_t stepX1 = e[1].a * SubPixelSteps;
+    const std::int64_t stepX2 = e[2].a * SubPixelSteps;
+    const std::int64_t stepY0 = e[0].b * SubPixelSteps;
+    const std::int64_t stepY1 = e[1].b * SubPixelSteps;
+    const std::int64_t stepY2 = e[2].b * SubPixelSteps;
+
+    for ( int y = minY; y <= maxY; ++y )
+    {
+        std::int64_t w0 = row0;
+        std::int64_t w1 = row1;
+        std::int64_t w2 = row2;
+
+        for ( int x = minX; x <= maxX; ++x )
+        {
+            // The pixel is inside the triangle if all edge equations are non-negative.
+            if ( ( w0 | w1 | w2 ) >= 0 )
+            {
+                ++pixelsTested;
+
+                if ( shadePixel<State>( tri, x, y, command, pixelsWritten ) )
+                {
+                    ++pixelsPassed;
+                    if constexpr ( State.pass != RasterPass::Depth )
+                        ++shaded;
+                }
+            }
+
+            w0 += stepX0;
+            w1 += stepX1;
+            w2 += stepX2;
+        }
+
+        row0 += stepY0;
+        row1 += stepY1;
+        row2 += stepY2;
+    }
+
+    // Update the hierarchical depth of the blocks that were rasterized.
+    if constexpr ( State.pass != RasterPass::ShadeEqual )
+    {
+        for ( int blockY = minY / BlockSize; blockY <= maxY / BlockSize; ++blockY )
+        {
+            for ( int blockX = minX / BlockSize; blockX <= maxX / BlockSize; ++blockX )
+                updateHiZ<State.depthFormat>( blockX, blockY );
+        }
+    }
+
+    stats.pixelsTested += pixelsTested;
+    stats.pixelsPassed += pixelsPassed;
+    stats.pixelsWritten += pixelsWritten;
+    stats.fragmentsShaded += shaded;
+}
+
+template<Rasterizer::PipelineState State>
+void Rasterizer::rasterizeSamples( const Triangle& tri, int minX, int minY, int maxX, int maxY, const DrawCommand& command, Statistics& stats )
+{
+    static_assert( NumSamples == 4, "The depth test assumes 4 samples per pixel." );
+
+    // The maximum rounding error of the depth of a sample (depth values are in the range [0..1]).
+    constexpr float SampleDepthEpsilon = 1e-6f;
+
+    using Depth     = DepthTraits<State.depthFormat>;
+    using DepthType = typename Depth::Type;
+
+    constexpr bool depthEqual = State.pass == RasterPass::ShadeEqual;
+    constexpr bool depthOnly  = State.pass == RasterPass::Depth;
+
+    // The number of samples that were depth tested, passed the depth test, and were written, and the number of pixels that were shaded.
+    std::size_t pixelsTested  = 0u;
+    std::size_t pixelsPassed  = 0u;
+    std::size_t pixelsWritten = 0u;
+    std::size_t shaded        = 0u;
+
+    const Edge* e = tri.e;
+
+    // Edge equation increments for one pixel step in x and y.
+    std::int64_t stepX[3], stepY[3];
+    // The offsets of the edge equations at the samples from their value at the center of the pixel.
+    std::int64_t sampleOffset[3][NumSamples];
+    // The offset from the value of an edge equation at the center of the first pixel of a block to its minimum and maximum value at the samples in the block.
+    std::int64_t minOffset[3], maxOffset[3];
+
+    for ( int i = 0; i < 3; ++i )
+    {
+        stepX[i] = e[i].a * SubPixelSteps;
+        stepY[i] = e[i].b * SubPixelSteps;
+
+        for ( int s = 0; s < NumSamples; ++s )
+            sampleOffset[i][s] = e[i].a * SampleOffsets[s][0] + e[i].b * SampleOffsets[s][1];
+
+        const auto [minSample, maxSample] = std::minmax( { sampleOffset[i][0], sampleOffset[i][1], sampleOffset[i][2], sampleOffset[i][3] } );
+
+        minOffset[i] = ( std::min<std::int64_t>( stepX[i], 0 ) + std::min<std::int64_t>( stepY[i], 0 ) ) * ( BlockSize - 1 ) + minSample;
+        maxOffset[i] = ( std::max<std::int64_t>( stepX[i], 0 ) + std::max<std::int64_t>( stepY[i], 0 ) ) * ( BlockSize - 1 ) + maxSample;
+    }
+
+    const int blockMinX = minX & ~( BlockSize - 1 );
+    const int blockMinY = minY & ~( BlockSize - 1 );
+
+    // Evaluate the edge equations at the center of the first pixel of the first block.
+    const std::int64_t px = static_cast<std::int64_t>( blockMinX ) * SubPixelSteps + SubPixelSteps / 2;
+    const std::int64_t py = static_cast<std::int64_t>( blockMinY ) * SubPixelSteps + SubPixelSteps / 2;
+
+    std::int64_t blockRow[3];
+    for ( int i = 0; i < 3; ++i )
+        blockRow[i] = e[i].a * px + e[i].b * py + e[i].c;
+
+    // The offsets of the depth at the samples from the depth at the center of the pixel.
+    float sampleZ[NumSamples];
+    for ( int s = 0; s < NumSamples; ++s )
+        sampleZ[s] = ( tri.z.dx * static_cast<float>( SampleOffsets[s][0] ) + tri.z.dy * static_cast<float>( SampleOffsets[s][1] ) ) / static_cast<float>( SubPixelSteps );
+
+    // The offset from the depth at the first pixel of a block to the minimum depth of the samples in the block.
+    // The samples are less than half a pixel away from the center of the pixel.
+    const float sampleZRange = ( std::abs( tri.z.dx ) + std::abs( tri.z.dy ) ) * 0.5f;
+    const float minZOffset   = ( std::min( tri.z.dx, 0.0f ) + std::min( tri.z.dy, 0.0f ) ) * ( BlockSize - 1 ) - sampleZRange;
+
+    // The samples of a pixel are stored next to each other.
+    auto&      depthTarget = getDepthTarget<State.depthFormat>();
+    DepthType* depthData   = depthTarget.data();
+    Color*     colorData   = colorSamples.data();
+    const auto stride      = depthTarget.getWidth();
+
+    std::uint64_t*      visibilityData = State.visibilityBuffer ? visibilityBuffer.data() : nullptr;
+    const std::uint64_t visibilityId   = makeVisibilityId( tri );
+
+#if SR_SSE2
+    // The samples of a pixel are processed in the 4 lanes of a vector.
+    const __m128  zOffsets   = _mm_set_ps( sampleZ[3], sampleZ[2], sampleZ[1], sampleZ[0] );
+    const __m128i sampleBits = _mm_set_epi32( 8, 4, 2, 1 );
+#endif
+
+    for ( int by = blockMinY; by <= maxY; by += BlockSize )
+    {
+        const int y0 = std::max( by, minY );
+        const int y1 = std::min( by + BlockSize - 1, maxY );
+
+        for ( int bx = blockMinX; bx <= maxX; bx += BlockSize )
+        {
+            const int x0 = std::max( bx, minX );
+            const int x1 = std::min( bx + BlockSize - 1, maxX );
+
+            // Edge equations at the center of the first pixel of the block.
+            std::int64_t w[3];
+            for ( int i = 0; i < 3; ++i )
+                w[i] = blockRow[i] + stepX[i] * ( bx - blockMinX );
+
+            // Trivial reject: all samples of the block are outside of one of the edges.
+            if ( w[0] + maxOffset[0] < 0 || w[1] + maxOffset[1] < 0 || w[2] + maxOffset[2] < 0 )
+                continue;
+
+            // Trivial accept: all samples of the block are inside of the triangle.
+            const bool partial = w[0] + minOffset[0] < 0 || w[1] + minOffset[1] < 0 || w[2] + minOffset[2] < 0;
+
+            // Hierarchical depth test (see rasterizeBlocks).
+            // The depth of the samples is rounded differently than the depth of the block, so the nearest depth
+            // of the block is moved forward by SampleDepthEpsilon.
+            const int   blockX    = bx / BlockSize;
+            const int   blockY    = by / BlockSize;
+            const float blockZ    = tri.z( static_cast<float>( bx - tri.minX ), static_cast<float>( by - tri.minY ) );
+            const float blockMinZ = std::max( blockZ + minZOffset, tri.minZ ) - SampleDepthEpsilon;
+
+            if ( depthEqual ? blockMinZ > hiZMax( blockX, blockY ) + Depth::Tolerance : blockMinZ >= hiZMax( blockX, blockY ) )
+                continue;
+
+            // Set if the depth of any sample in the block was written.
+            bool written = false;
+
+            for ( int y = y0; y <= y1; ++y )
+            {
+                DepthType*     depthRow      = depthData + static_cast<std::size_t>( y ) * stride;
+                Color*         colorRow      = colorData + static_cast<std::size_t>( y ) * stride;
+                std::uint64_t* visibilityRow = visibilityData ? visibilityData + static_cast<std::size_t>( y ) * stride : nullptr;
+
+                // The offset of the row from the origin of the plane equations.
+                const float fy = static_cast<float>( y - tri.minY );
 
-Rasterizer::Rasterizer( std::size_t width, std::size_t height )
-: width { width }
-, height { height }
-, renderTarget { static_cast<uint32_t>( width ), static_cast<uint32_t>( height ) }
-, depthBuffer { width, height }
-, viewport { 0.0f, 0.0f, static_cast<float>( width ), static_cast<float>( height ) }
-{}
+                for ( int x = x0; x <= x1; ++x )
+                {
+                    // Coverage test of the samples.
+                    int coverage = ( 1 << NumSamples ) - 1;
+                    if ( partial )
+                    {
+                        std::int64_t p[3];
+                        for ( int i = 0; i < 3; ++i )
+                            p[i] = w[i] + stepX[i] * ( x - bx ) + stepY[i] * ( y - by );
 
-void Rasterizer::clear( const Color& color, float depth )
-{
-    renderTarget.clear( color );
-    depthBuffer.clear( depth );
-}
+                        for ( int s = 0; s < NumSamples; ++s )
+                        {
+                            if ( p[0] + sampleOffset[0][s] < 0 || p[1] + sampleOffset[1][s] < 0 || p[2] + sampleOffset[2][s] < 0 )
+                                coverage &= ~( 1 << s );
+                        }
+                    }
 
-void Rasterizer::draw( const Mesh& mesh, const glm::mat4& modelMatrix )
-{
-    // TODO: View frustum culling.
+                    if ( coverage == 0 )
+                        continue;
 
-    glm::mat4 modelViewProjectionMatrix = modelMatrix;
-    glm::mat4 modelViewMatrix           = modelMatrix;
-    if ( camera )
-    {
-        modelViewMatrix           = camera->getViewMatrix() * modelMatrix;
-        modelViewProjectionMatrix = camera->getViewProjectionMatrix() * modelMatrix;
-    }
+                    pixelsTested += std::popcount( static_cast<unsigned>( coverage ) );
 
-    Material* material       = mesh.getMaterial().get();
-    Image*    alphaTexture   = material ? material->alphaTexture.get() : nullptr;
-    Image*    diffuseTexture = material ? material->diffuseTexture.get() : nullptr;
-    Color     diffuseColor   = material ? material->diffuseColor : Color::Magenta;
+                    const float fx = static_cast<float>( x - tri.minX );
+                    const float z  = tri.z( fx, fy );
 
-    AABB viewportAABB = AABB::fromViewport( viewport );
-    viewportAABB.max  = viewportAABB.max - glm::vec3( 1, 1, 0 );
+                    DepthType* depth = depthRow + static_cast<std::size_t>( x ) * NumSamples;
 
-    // Mesh must be triangulated.
-    // TODO: Topology?
-    assert( mesh.getNumIndices() % 3 == 0 );
-    std::size_t numTris = mesh.getNumIndices() / 3;
+                    // Depth test of the covered samples.
+#if SR_SSE2
+                    const __m128 zs      = Depth::encode( _mm_add_ps( _mm_set1_ps( z ), zOffsets ) );
+                    const __m128 d       = Depth::load( depth );
+                    const __m128 covered = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( _mm_set1_epi32( coverage ), sampleBits ), sampleBits ) );
+                    const __m128 pass    = _mm_and_ps( depthEqual ? Depth::equal( zs, d ) : Depth::less( zs, d ), covered );
+                    const int    mask    = _mm_movemask_ps( pass );
+#else
+                    DepthType zs[NumSamples];
+                    int       mask = 0;
+                    for ( int s = 0; s < NumSamples; ++s )
+                    {
+                        zs[s] = Depth::encode( z + sampleZ[s] );
+                        if ( ( coverage & ( 1 << s ) ) && ( depthEqual ? zs[s] == depth[s] : zs[s] < depth[s] ) )
+                            mask |= 1 << s;
+                    }
+#endif
+                    if ( mask == 0 )
+                        continue;
 
-    auto* indices = mesh.getIndices().data();
+                    const int numPassed = std::popcount( static_cast<unsigned>( mask ) );
+                    pixelsPassed += numPassed;
 
-    auto* positions = mesh.getPositions().data();
-    auto* normals   = mesh.getNormals().data();
-    auto* uvs       = mesh.getTexCoords().data();
+                    // The pixel is shaded once, at its center.
+                    [[maybe_unused]] TexCoords tc {};
+                    if constexpr ( State.texCoords() )
+                    {
+                        tc = interpolateTexCoords( tri, fx, fy );
 
-    for ( std::size_t i = 0; i < numTris; ++i )
-    {
-        VertexOutput tri[3];
-        for ( std::size_t v = 0; v < 3; ++v )
-        {
-            int vertexId = indices[i * 3 + v];
+                        // The color and depth are only written if the pixel passes the alpha test.
+                        if constexpr ( State.alphaTest )
+                        {
+                            if ( sampler.sampleNearest( *command.alphaTexture, tc.uv, sampler.getLOD( *command.alphaTexture, tc.ddx, tc.ddy ) ).r == 0 )
+                                continue;
+                        }
+                    }
 
-            VertexInput in;
+                    pixelsWritten += numPassed;
+
+                    if constexpr ( !depthEqual )
+                    {
+#if SR_SSE2
+                        Depth::store( depth, _mm_or_ps( _mm_and_ps( pass, zs ), _mm_andnot_ps( pass, d ) ) );
+#else
+                        for ( int m = mask; m; m &= m - 1 )
+                        {
+                            const int s = std::countr_zero( static_cast<unsigned>( m ) );
+                            depth[s]    = zs[s];
+                        }
+#endif
+                        written = true;
+                    }
+
+                    if constexpr ( State.visibilityBuffer )
+                    {
+                        // Shading is deferred to the resolve pass.
+                        for ( int m = mask; m; m &= m - 1 )
+                            visibilityRow[static_cast<std::size_t>( x ) * NumSamples + std::countr_zero( static_cast<unsigned>( m ) )] = visibilityId;
+                    }
+                    else if constexpr ( !depthOnly )
+                    {
+                        Color color = command.diffuseColor;
+                        if constexpr ( State.diffuseTexture )
+                            color = sampler.sample( *command.diffuseTexture, tc.uv, sampler.getLOD( *command.diffuseTexture, tc.ddx, tc.ddy ) );
+
+                        if constexpr ( State.shadows )
+                            color = applyShadow( color, tri, fx, fy, 1.0f / tri.invW( fx, fy ) );
+
+                        Color* samples = colorRow + static_cast<std::size_t>( x ) * NumSamples;
+#if SR_SSE2
+                        const __m128i passI = _mm_castps_si128( pass );
+                        const __m128i src   = _mm_set1_epi32( static_cast<int>( std::bit_cast<std::uint32_t>( color ) ) );
+                        const __m128i dst   = _mm_loadu_si128( reinterpret_cast<const __m128i*>( samples ) );
+                        _mm_storeu_si128( reinterpret_cast<__m128i*>( samples ), _mm_or_si128( _mm_and_si128( passI, src ), _mm_andnot_si128( passI, dst ) ) );
+#else
+                        for ( int m = mask; m; m &= m - 1 )
+                            samples[std::countr_zero( static_cast<unsigned>( m ) )] = color;
+#endif
+                    }
 
-            in.position = positions[vertexId];
-            in.normal   = normals[vertexId];
-            in.uv       = uvs[vertexId];
+                    if constexpr ( !depthOnly )
+                        ++shaded;
+                }
+            }
 
-            tri[v] = vertexShader( in, modelMatrix, modelViewMatrix, modelViewProjectionMatrix );
+            if ( written )
+                updateHiZ<State.depthFormat>( blockX, blockY );
         }
 
-        VertexOutput out[4];
-        int          n_out = clipTriangle( tri, out );
+        for ( int i = 0; i < 3; ++i )
+            blockRow[i] += stepY[i] * BlockSize;
+    }
 
-        switch ( n_out )
-        {
-        case 3:
+    stats.pixelsTested += pixelsTested;
+    stats.pixelsPassed += pixelsPassed;
+    stats.pixelsWritten += pixelsWritten;
+    stats.fragmentsShaded += shaded;
+}
+
+template<Rasterizer::PipelineState State>
+bool Rasterizer::shadePixel( const Triangle& tri, int x, int y, const DrawCommand& command, std::size_t& pixelsWritten ) noexcept
+{
+    using Depth = DepthTraits<State.depthFormat>;
+
+    // The offset of the pixel from the origin of the plane equations.
+    const float dx = static_cast<float>( x - tri.minX );
+    const float dy = static_cast<float>( y - tri.minY );
+
+    // Depth test.
+    auto&      depth = getDepthTarget<State.depthFormat>()( x, y );
+    const auto z     = Depth::encode( tri.z( dx, dy ) );
+    if ( !( State.pass == RasterPass::ShadeEqual ? z == depth : z < depth ) )
+        return false;
+
+    [[maybe_unused]] TexCoords tc {};
+    if constexpr ( State.texCoords() )
+    {
+        tc = interpolateTexCoords( tri, dx, dy );
+
+        // The color and depth are only written if the fragment passes the alpha test.
+        if constexpr ( State.alphaTest )
         {
-            rasterize( out, viewportAABB, alphaTexture, diffuseTexture, diffuseColor );
+            if ( sampler.sampleNearest( *command.alphaTexture, tc.uv, sampler.getLOD( *command.alphaTexture, tc.ddx, tc.ddy ) ).r == 0 )
+                return true;
         }
-        break;
-        case 4:
-        {
-            tri[0] = out[0];
-            tri[1] = out[1];
-            tri[2] = out[3];
+    }
 
-            rasterize( tri, viewportAABB, alphaTexture, diffuseTexture, diffuseColor );
+    ++pixelsWritten;
 
-            tri[0] = out[1];
-            tri[1] = out[2];
-            tri[2] = out[3];
+    if constexpr ( State.pass != RasterPass::ShadeEqual )
+        depth = z;
 
-            rasterize( tri, viewportAABB, alphaTexture, diffuseTexture, diffuseColor );
-        }
-        break;
-        }
+    if constexpr ( State.visibilityBuffer )
+    {
+        visibilityBuffer( x, y ) = makeVisibilityId( tri );
+    }
+    else if constexpr ( State.pass != RasterPass::Depth )
+    {
+        Color color = command.diffuseColor;
+        if constexpr ( State.diffuseTexture )
+            color = sampler.sample( *command.diffuseTexture, tc.uv, sampler.getLOD( *command.diffuseTexture, tc.ddx, tc.ddy ) );
+
+        if constexpr ( State.shadows )
+            color = applyShadow( color, tri, dx, dy, 1.0f / tri.invW( dx, dy ) );
+
+        getColorTarget()( x, y ) = color;
     }
+
+    return true;
 }
 
-void Rasterizer::rasterize( VertexOutput tri[3], const AABB& viewportAABB, const Image* alphaTexture, const Image* diffuseTexture, const Color& diffuseColor )
+Rasterizer::TexCoords Rasterizer::interpolateTexCoords( const Triangle& tri, float x, float y ) noexcept
 {
-    // Store the w component before perspective divide.
-    float w0 = 1.0f / tri[0].position.w;
-    float w1 = 1.0f / tri[1].position.w;
-    float w2 = 1.0f / tri[2].position.w;
+    // Compute the perspective correct texture coordinates.
+    // Source: OpenGL 4.6 Specification, 2022 (pp. 479).
+    const float     correction = 1.0f / tri.invW( x, y );
+    const glm::vec2 uv         = glm::vec2 { tri.u( x, y ), tri.v( x, y ) } * correction;
 
-    for ( int i = 0; i < 3; ++i )
-    {
-        auto& pos = tri[i].position;
-        pos       = pos / pos.w;  // Perspective divide.
+    // The derivatives of u = (u/w) / (1/w) are (d(u/w) - u * d(1/w)) * w.
+    return {
+        uv,
+        ( glm::vec2 { tri.u.dx, tri.v.dx } - uv * tri.invW.dx ) * correction,
+        ( glm::vec2 { tri.u.dy, tri.v.dy } - uv * tri.invW.dy ) * correction
+    };
+}
 
-        // NDC -> screen space
-        pos   = pos * 0.5f + 0.5f;
-        pos.x = pos.x * viewport.width + viewport.x;
-        pos.y = ( 1.0f - pos.y ) * viewport.height + viewport.y;  // Flip Y
-    }
+Color Rasterizer::applyShadow( const Color& color, const Triangle& tri, float x, float y, float w ) const noexcept
+{
+    const glm::vec3 lightPosition = glm::vec3 { tri.lx( x, y ), tri.ly( x, y ), tri.lz( x, y ) } * w;
+    const float     light         = shadowMap->getLight( lightPosition );
 
-    // Backface culling.
-    // Compute the area of the triangle in screen space.
-    // Source: OpenGL 4.6 Specification, 2022 (pp. 477)
-    auto a = -( ( tri[0].position.x * tri[1].position.y - tri[1].position.x * tri[0].position.y ) + ( tri[1].position.x * tri[2].position.y - tri[2].position.x * tri[1].position.y ) + ( tri[2].position.x * tri[0].position.y - tri[0].position.x * tri[2].position.y ) );
-    if ( a < 0.0f )
-        return;
+    return {
+        static_cast<std::uint8_t>( static_cast<float>( color.r ) * light ),
+        static_cast<std::uint8_t>( static_cast<float>( color.g ) * light ),
+        static_cast<std::uint8_t>( static_cast<float>( color.b ) * light ),
+        color.a
+    };
+}
+
+template<Rasterizer::DepthFormat Format>
+void Rasterizer::updateHiZ( int blockX, int blockY ) noexcept
+{
+    using Depth = DepthTraits<Format>;
+
+    const auto& depthTarget = getDepthTarget<Format>();
+
+    // With multisampling, the samples of a pixel are stored next to each other.
+    const int samples = multisampling ? NumSamples : 1;
 
-    auto aabb = Math::AABB::fromTriangle( tri[0].position, tri[1].position, tri[2].position );
+    const int x0 = blockX * BlockSize * samples;
+    const int y0 = blockY * BlockSize;
+    const int x1 = std::min( x0 + BlockSize * samples, static_cast<int>( depthTarget.getWidth() ) );
+    const int y1 = std::min( y0 + BlockSize, static_cast<int>( depthTarget.getHeight() ) );
 
-    // Clamp the triangle AABB to the AABB of the viewport.
-    aabb.clamp( viewportAABB );
+    auto minZ = depthTarget( x0, y0 );
+    auto maxZ = minZ;
 
-    for ( int y = static_cast<int>( aabb.min.y ); y <= static_cast<int>( aabb.max.y ); ++y )
+    for ( int y = y0; y < y1; ++y )
     {
-        for ( int x = static_cast<int>( aabb.min.x ); x <= static_cast<int>( aabb.max.x ); ++x )
+        const auto* depthRow = &depthTarget( 0, y );
+        for ( int x = x0; x < x1; ++x )
         {
-            // Barycentric coordinates in screen space.
-            auto bc = barycentric( tri[0].position, tri[1].position, tri[2].position, { static_cast<float>( x ) + 0.5f, static_cast<float>( y ) + 0.5f } );
-            if ( barycentricInside( bc ) )
-            {
-                // Compute depth
-                float  z = tri[0].position.z * bc.x + tri[1].position.z * bc.y + tri[2].position.z * bc.z;
-                float& d = depthBuffer( x, y );
-                if ( z < d )
-                {
-                    bc = bc * glm::vec3 { w0, w1, w2 };
-                    // Compute the perspective correct attributes.
-                    // Source: OpenGL 4.6 Specification, 2022 (pp. 479).
-                    float correction = 1.0f / ( bc.x + bc.y + bc.z );
-                    auto  uv         = ( tri[0].uv * bc.x + tri[1].uv * bc.y + tri[2].uv * bc.z ) * correction;
-                    auto  normal         = ( tri[0].normal * bc.x + tri[1].normal * bc.y + tri[2].normal * bc.z ) * correction;
-                    normal           = glm::normalize( normal );
+            minZ = std::min( minZ, depthRow[x] );
+            maxZ = std::max( maxZ, depthRow[x] );
+        }
+    }
 
-                    auto  srcAlpha   = alphaTexture ? alphaTexture->sample( uv ) : Color::White;
+    hiZMin( blockX, blockY ) = Depth::decode( minZ );
+    hiZMax( blockX, blockY ) = Depth::decode( maxZ );
+}
 
-                    if ( srcAlpha.r > 0 )
-                    {
-                        auto srcColor        = diffuseTexture ? diffuseTexture->sample( uv ) : diffuseColor;
-                        renderTarget( x, y ) = srcColor;
+void Rasterizer::updateHiZ( const RectI& rect ) noexcept
+{
+    if ( rect.width <= 0 || rect.height <= 0 )
+        return;
 
-                        // Update the depth buffer.
-                        d = z;
-                    }
-                }
+    const int blockX0 = rect.left / BlockSize;
+    const int blockY0 = rect.top / BlockSize;
+    const int blockX1 = ( rect.right() - 1 ) / BlockSize;
+    const int blockY1 = ( rect.bottom() - 1 ) / BlockSize;
+
+    for ( int blockY = blockY0; blockY <= blockY1; ++blockY )
+    {
+        for ( int blockX = blockX0; blockX <= blockX1; ++blockX )
+        {
+            switch ( depthFormat )
+            {
+            case DepthFormat::Float32:
+                updateHiZ<DepthFormat::Float32>( blockX, blockY );
+                break;
+            case DepthFormat::Unorm24:
+                updateHiZ<DepthFormat::Unorm24>( blockX, blockY );
+                break;
+            case DepthFormat::Unorm16:
+                updateHiZ<DepthFormat::Unorm16>( blockX, blockY );
+                break;
             }
         }
     }
@@ -172,17 +1951,235 @@ void Rasterizer::setViewport( const Math::Viewport& _viewport ) noexcept
     viewport = _viewport;
 }
 
+void Rasterizer::setOcclusionCuller( const OcclusionCuller* _occlusionCuller ) noexcept
+{
+    occlusionCuller = _occlusionCuller;
+}
+
+void Rasterizer::setShadowMap( const ShadowMap* _shadowMap ) noexcept
+{
+    shadowMap = _shadowMap;
+}
+
+void Rasterizer::setSampler( const Sampler& _sampler ) noexcept
+{
+    sampler = _sampler;
+}
+
+const Sampler& Rasterizer::getSampler() const noexcept
+{
+    return sampler;
+}
+
+void Rasterizer::setRasterMode( RasterMode mode ) noexcept
+{
+    rasterMode = mode;
+}
+
+Rasterizer::RasterMode Rasterizer::getRasterMode() const noexcept
+{
+    return rasterMode;
+}
+
+void Rasterizer::setShadingMode( ShadingMode mode )
+{
+    shadingMode = mode;
+
+    if ( shadingMode == ShadingMode::VisibilityBuffer )
+        visibilityBuffer.resize( width * ( multisampling ? NumSamples : 1 ), height );
+}
+
+Rasterizer::ShadingMode Rasterizer::getShadingMode() const noexcept
+{
+    return shadingMode;
+}
+
+void Rasterizer::setDepthPrePass( bool enabled ) noexcept
+{
+    depthPrePass = enabled;
+}
+
+bool Rasterizer::getDepthPrePass() const noexcept
+{
+    return depthPrePass;
+}
+
+void Rasterizer::setMultisampling( bool enabled )
+{
+    multisampling = enabled;
+
+    // The samples of a pixel are stored next to each other, so the depth and visibility buffers are NumSamples times wider.
+    const std::size_t samples = multisampling ? NumSamples : 1;
+
+    switch ( depthFormat )
+    {
+    case DepthFormat::Float32:
+        depthBuffer.resize( width * samples, height );
+
+        // A bound depth target belongs to the caller, so it is unbound instead of resized.
+        if ( boundDepthTarget && boundDepthTarget->getWidth() != width * samples )
+        {
+            std::cerr << "ERROR: The depth target does not match the depth buffer of the rasterizer after changing the multisampling. The depth target is unbound." << std::endl;
+            boundDepthTarget = nullptr;
+        }
+        break;
+    case DepthFormat::Unorm24:
+        depthBuffer24.resize( width * samples, height );
+        break;
+    case DepthFormat::Unorm16:
+        depthBuffer16.resize( width * samples, height );
+        break;
+    }
+
+    if ( multisampling )
+        colorSamples.resize( width * NumSamples, height );
+
+    if ( shadingMode == ShadingMode::VisibilityBuffer )
+        visibilityBuffer.resize( width * samples, height );
+}
+
+bool Rasterizer::getMultisampling() const noexcept
+{
+    return multisampling;
+}
+
+void Rasterizer::setLODThreshold( float pixels ) noexcept
+{
+    lodThreshold = pixels;
+}
+
+float Rasterizer::getLODThreshold() const noexcept
+{
+    return lodThreshold;
+}
+
+float Rasterizer::getScreenSize( const Math::AABB& aabb, const glm::mat4& modelViewMatrix ) const noexcept
+{
+    constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+    if ( !camera )
+        return Infinity;
+
+    // The bounding sphere of the AABB in view space (scaled by the largest scale of the model-view matrix).
+    const glm::vec3 center = modelViewMatrix * glm::vec4 { aabb.center(), 1.0f };
+    const float     scale  = std::sqrt( std::max( { glm::dot( glm::vec3 { modelViewMatrix[0] }, glm::vec3 { modelViewMatrix[0] } ),
+                                                    glm::dot( glm::vec3 { modelViewMatrix[1] }, glm::vec3 { modelViewMatrix[1] } ),
+                                                    glm::dot( glm::vec3 { modelViewMatrix[2] }, glm::vec3 { modelViewMatrix[2] } ) } ) );
+    const float     radius = glm::length( aabb.extent() ) * scale;
+
+    // The projection matrix scales the view-space height to normalized device coordinates [-1...1].
+    const glm::mat4& projectionMatrix = camera->getProjectionMatrix();
+    const float      pixelsPerUnit    = projectionMatrix[1][1] * 0.5f * viewport.height;
+
+    // Orthographic projection.
+    if ( projectionMatrix[2][3] == 0.0f )
+        return 2.0f * radius * pixelsPerUnit;
+
+    // Perspective projection.
+    const float distance = -center.z;
+    if ( distance <= radius )
+        return Infinity;
+
+    return 2.0f * radius * pixelsPerUnit / distance;
+}
+
 const Image& Rasterizer::getImage() const noexcept
 {
-    return renderTarget;
+    if ( boundColorTarget )
+        return *boundColorTarget;
+
+    // Between present and the next clear, the render target belongs to the presented frame.
+    return presentedFrame ? presentedFrame->image : renderTarget;
+}
+
+Image& Rasterizer::getColorTarget() noexcept
+{
+    return boundColorTarget ? *boundColorTarget : renderTarget;
+}
+
+void Rasterizer::setRenderTarget( Image* image )
+{
+    if ( image && ( image->getWidth() < width || image->getHeight() < height ) )
+    {
+        std::cerr << "ERROR: The render target (" << image->getWidth() << "x" << image->getHeight() << ") is smaller than the rasterizer (" << width << "x" << height << ")." << std::endl;
+        return;
+    }
+
+    boundColorTarget = image;
+}
+
+void Rasterizer::setDepthTarget( Buffer<float>* depthTarget )
+{
+    if ( depthTarget && depthFormat != DepthFormat::Float32 )
+    {
+        std::cerr << "ERROR: A depth target can only be bound with DepthFormat::Float32." << std::endl;
+        return;
+    }
+
+    const std::size_t samples = multisampling ? NumSamples : 1;
+
+    if ( depthTarget && ( depthTarget->getWidth() != width * samples || depthTarget->getHeight() != height ) )
+    {
+        std::cerr << "ERROR: The depth target (" << depthTarget->getWidth() << "x" << depthTarget->getHeight() << ") does not match the depth buffer of the rasterizer (" << width * samples << "x" << height << ")." << std::endl;
+        return;
+    }
+
+    boundDepthTarget = depthTarget;
+
+    // The hierarchical depth must match the contents of the depth buffer that is now in use.
+    updateHiZ( RectI { 0, 0, static_cast<int>( width ), static_cast<int>( height ) } );
+}
+
+RectI Rasterizer::getViewportRect() const noexcept
+{
+    const int x0 = std::clamp( static_cast<int>( std::floor( viewport.x ) ), 0, static_cast<int>( width ) );
+    const int y0 = std::clamp( static_cast<int>( std::floor( viewport.y ) ), 0, static_cast<int>( height ) );
+    const int x1 = std::clamp( static_cast<int>( std::ceil( viewport.x + viewport.width ) ), x0, static_cast<int>( width ) );
+    const int y1 = std::clamp( static_cast<int>( std::ceil( viewport.y + viewport.height ) ), y0, static_cast<int>( height ) );
+
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+Rasterizer::DepthFormat Rasterizer::getDepthFormat() const noexcept
+{
+    return depthFormat;
+}
+
+const Buffer<float>& Rasterizer::getDepthBuffer() const
+{
+    // Between present and the next clear, the (decoded) depth buffer belongs to the presented frame.
+    if ( presentedFrame && !boundDepthTarget )
+        return presentedFrame->depthBuffer;
+
+    const std::size_t samples = multisampling ? NumSamples : 1;
+
+    switch ( depthFormat )
+    {
+    case DepthFormat::Unorm24:
+        decodeDepth<DepthFormat::Unorm24>( depthBuffer24, decodedDepthBuffer, samples );
+        return decodedDepthBuffer;
+    case DepthFormat::Unorm16:
+        decodeDepth<DepthFormat::Unorm16>( depthBuffer16, decodedDepthBuffer, samples );
+        return decodedDepthBuffer;
+    default:
+    {
+        const Buffer<float>& depthTarget = boundDepthTarget ? *boundDepthTarget : depthBuffer;
+        if ( multisampling )
+        {
+            decodeDepth<DepthFormat::Float32>( depthTarget, decodedDepthBuffer, samples );
+            return decodedDepthBuffer;
+        }
+        return depthTarget;
+    }
+    }
 }
 
-const Buffer<float>& Rasterizer::getDepthBuffer() const noexcept
+const Rasterizer::Statistics& Rasterizer::getStatistics() const noexcept
 {
-    return depthBuffer;
+    return statistics;
 }
 
-inline Rasterizer::VertexOutput Rasterizer::vertexShader( const VertexInput& in, const glm::mat4& modelMatrix, const glm::mat4& modeViewMatrix, const glm::mat4& modelViewProjectionMatrix )
+inline Rasterizer::VertexOutput Rasterizer::vertexShader( const VertexInput& in, const glm::mat4& modelMatrix, const glm::mat4& modeViewMatrix, const glm::mat4& modelViewProjectionMatrix ) const
 {
     VertexOutput out {};
 
@@ -193,29 +2190,146 @@ inline Rasterizer::VertexOutput Rasterizer::vertexShader( const VertexInput& in,
     return out;
 }
 
-float Rasterizer::distance( const glm::vec4& p, Plane plane )
+void Rasterizer::transformVertices( const Mesh& mesh, const glm::mat4& modelMatrix, const glm::mat4& modelViewMatrix, const glm::mat4& modelViewProjectionMatrix, std::vector<VertexOutput>& vertices, int firstVertex, int lastVertex ) const
+{
+    const glm::vec3* positions = mesh.getPositions().data();
+    const glm::vec3* normals   = mesh.getNormals().data();
+    const glm::vec3* uvs       = mesh.getTexCoords().data();
+
+    assert( lastVertex <= static_cast<int>( vertices.size() ) );
+
+    // Vertices that are shared by multiple triangles are only transformed once.
+    const int numVertices = lastVertex - firstVertex;
+    const int numBatches  = ( numVertices + VertexBatchSize - 1 ) / VertexBatchSize;
+
+    VertexOutput* out = vertices.data();
+
+    // With a shadow map, the vertices are also transformed to light-space.
+    const bool      shadows     = shadowMap != nullptr;
+    const glm::mat4 lightMatrix = shadows ? shadowMap->getLightViewMatrix() * modelMatrix : glm::mat4 { 1.0f };
+
+#if SR_SSE2
+    // Broadcast the matrix elements. mvp[c][r] contains the element in column c and row r.
+    __m128 mvp[4][4], mv[3][3], lm[4][3];
+    for ( int c = 0; c < 4; ++c )
+    {
+        for ( int r = 0; r < 4; ++r )
+            mvp[c][r] = _mm_set1_ps( modelViewProjectionMatrix[c][r] );
+    }
+    for ( int c = 0; c < 3; ++c )
+    {
+        for ( int r = 0; r < 3; ++r )
+            mv[c][r] = _mm_set1_ps( modelViewMatrix[c][r] );
+    }
+    for ( int c = 0; c < 4; ++c )
+    {
+        for ( int r = 0; r < 3; ++r )
+            lm[c][r] = _mm_set1_ps( lightMatrix[c][r] );
+    }
+#endif
+
+#pragma omp parallel for schedule( static ) if ( numBatches > 64 )
+    for ( int batch = 0; batch < numBatches; ++batch )
+    {
+        const int first = firstVertex + batch * VertexBatchSize;
+        const int last  = std::min( first + VertexBatchSize, lastVertex );
+
+        int i = first;
+
+#if SR_SSE2
+        // Transform 4 vertices at a time.
+        for ( ; i + 4 <= last; i += 4 )
+        {
+            const glm::vec3* p = positions + i;
+            const glm::vec3* n = normals + i;
+
+            // Convert the positions and normals to SoA.
+            const __m128 px = _mm_set_ps( p[3].x, p[2].x, p[1].x, p[0].x );
+            const __m128 py = _mm_set_ps( p[3].y, p[2].y, p[1].y, p[0].y );
+            const __m128 pz = _mm_set_ps( p[3].z, p[2].z, p[1].z, p[0].z );
+            const __m128 nx = _mm_set_ps( n[3].x, n[2].x, n[1].x, n[0].x );
+            const __m128 ny = _mm_set_ps( n[3].y, n[2].y, n[1].y, n[0].y );
+            const __m128 nz = _mm_set_ps( n[3].z, n[2].z, n[1].z, n[0].z );
+
+            // Clip-space positions (w = 1).
+            __m128 pos[4];
+            for ( int r = 0; r < 4; ++r )
+                pos[r] = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( mvp[0][r], px ), _mm_mul_ps( mvp[1][r], py ) ), _mm_mul_ps( mvp[2][r], pz ) ), mvp[3][r] );
+
+            // View-space normals (w = 0).
+            __m128 nrm[3];
+            for ( int r = 0; r < 3; ++r )
+                nrm[r] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( mv[0][r], nx ), _mm_mul_ps( mv[1][r], ny ) ), _mm_mul_ps( mv[2][r], nz ) );
+
+            // Convert the positions back to AoS.
+            _MM_TRANSPOSE4_PS( pos[0], pos[1], pos[2], pos[3] );
+
+            alignas( 16 ) float normal[3][4];
+            _mm_store_ps( normal[0], nrm[0] );
+            _mm_store_ps( normal[1], nrm[1] );
+            _mm_store_ps( normal[2], nrm[2] );
+
+            // Light-space positions (w = 1).
+            alignas( 16 ) float light[3][4];
+            if ( shadows )
+            {
+                for ( int r = 0; r < 3; ++r )
+                    _mm_store_ps( light[r], _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( lm[0][r], px ), _mm_mul_ps( lm[1][r], py ) ), _mm_mul_ps( lm[2][r], pz ) ), lm[3][r] ) );
+            }
+
+            for ( int j = 0; j < 4; ++j )
+            {
+                VertexOutput& o = out[i + j];
+
+                _mm_storeu_ps( &o.position.x, pos[j] );
+                o.normal = { normal[0][j], normal[1][j], normal[2][j] };
+                o.uv     = uvs[i + j];
+
+                if ( shadows )
+                    o.lightPosition = { light[0][j], light[1][j], light[2][j] };
+            }
+        }
+#endif
+
+        for ( ; i < last; ++i )
+        {
+            VertexInput in;
+
+            in.position = positions[i];
+            in.normal   = normals[i];
+            in.uv       = uvs[i];
+
+            out[i] = vertexShader( in, modelMatrix, modelViewMatrix, modelViewProjectionMatrix );
+
+            if ( shadows )
+                out[i].lightPosition = lightMatrix * glm::vec4 { in.position, 1.0f };
+        }
+    }
+}
+
+float Rasterizer::distance( const glm::vec4& p, Plane plane, const glm::vec2& guardBand )
 {
     switch ( plane )
     {
     case Plane::Left:
-        return p.x - p.w;
+        return p.x + p.w * guardBand.x;
     case Plane::Right:
-        return p.x + p.w;
+        return p.w * guardBand.x - p.x;
     case Plane::Top:
-        return p.y + p.w;
+        return p.w * guardBand.y - p.y;
     case Plane::Bottom:
-        return p.y - p.w;
+        return p.y + p.w * guardBand.y;
     case Plane::Near:
         return p.z + p.w;
     case Plane::Far:
-        return p.z - p.w;
+        return p.w - p.z;
     }
 
     return 0.0f;  // This shouldn't happen.
 }
 
 // Source: https://dl.acm.org/doi/pdf/10.1145/360767.360802
-int Rasterizer::clipTriangle( const VertexOutput* in, int n_in, VertexOutput* out, Plane plane )
+int Rasterizer::clipTriangle( const VertexOutput* in, int n_in, VertexOutput* out, Plane plane, const glm::vec2& guardBand )
 {
     // Number of output vertices.
     int n_out = 0;
@@ -229,8 +2343,8 @@ int Rasterizer::clipTriangle( const VertexOutput* in, int n_in, VertexOutput* ou
         VertexOutput P = in[( i + 1 ) % n_in];
 
         // Compute the signed distance to the plane.
-        float dS = distance( S.position, plane );
-        float dP = distance( P.position, plane );
+        float dS = distance( S.position, plane, guardBand );
+        float dP = distance( P.position, plane, guardBand );
 
         if ( dS >= 0.0f && dP >= 0.0f )
         {
@@ -273,7 +2387,56 @@ int Rasterizer::clipTriangle( const VertexOutput* in, int n_in, VertexOutput* ou
     return n_out;
 }
 
-int Rasterizer::clipTriangle( const VertexOutput in[3], VertexOutput* out )
+int Rasterizer::clipTriangle( const VertexOutput in[3], VertexOutput* out ) const noexcept
 {
-    return clipTriangle( in, 3, out, Plane::Near );
+    constexpr Plane planes[] = { Plane::Near, Plane::Far, Plane::Left, Plane::Right, Plane::Top, Plane::Bottom };
+
+    // Trivial reject: all vertices are outside of the same clipping plane.
+    for ( Plane plane: planes )
+    {
+        if ( distance( in[0].position, plane ) < 0.0f && distance( in[1].position, plane ) < 0.0f && distance( in[2].position, plane ) < 0.0f )
+            return 0;
+    }
+
+    // Backface culling in clip space.
+    // The determinant of the (x, y, w) rows is proportional to the signed volume of the
+    // tetrahedron formed by the eye and the triangle, so it is valid even for vertices behind the eye.
+    // Source: Marc Olano and Trey Greer, "Triangle Scan Conversion using 2D Homogeneous Coordinates", 1997.
+    const glm::vec3 r0 { in[0].position.x, in[0].position.y, in[0].position.w };
+    const glm::vec3 r1 { in[1].position.x, in[1].position.y, in[1].position.w };
+    const glm::vec3 r2 { in[2].position.x, in[2].position.y, in[2].position.w };
+
+    if ( glm::dot( r0, glm::cross( r1, r2 ) ) <= 0.0f )
+        return 0;
+
+    // The guard band in normalized device coordinates.
+    const glm::vec2 guardBand {
+        1.0f + 2.0f * GuardBand / viewport.width,
+        1.0f + 2.0f * GuardBand / viewport.height,
+    };
+
+    // Only clip against the planes that are exceeded by one of the vertices.
+    // The near plane is clipped first so the remaining vertices have a positive w.
+    VertexOutput tmp[MaxClippedVertices];
+
+    std::copy_n( in, 3, out );
+    int n = 3;
+
+    for ( Plane plane: planes )
+    {
+        bool clip = false;
+        for ( int i = 0; i < n && !clip; ++i )
+            clip = distance( out[i].position, plane, guardBand ) < 0.0f;
+
+        if ( !clip )
+            continue;
+
+        std::copy_n( out, n, tmp );
+        n = clipTriangle( tmp, n, out, plane, guardBand );
+
+        if ( n < 3 )
+            return 0;
+    }
+
+    return n;
 }
@@ -38,9 +38,41 @@ struct std::hash<FontKey>
     }
 };
 
+/// <summary>
+/// A key used to uniquely identify a texture.
+/// </summary>
+struct TextureKey
+{
+    std::filesystem::path filePath;
+    TextureLayout         layout;
+
+    bool operator==( const TextureKey& other ) const
+    {
+        return filePath == other.filePath && layout == other.layout;
+    }
+};
+
+// Hasher for a TextureKey.
+template<>
+struct std::hash<TextureKey>
+{
+    size_t operator()( const TextureKey& key ) const noexcept
+    {
+        std::size_t seed = 0;
+
+        hash_combine( seed, key.filePath );
+        hash_combine( seed, key.layout );
+
+        return seed;
+    }
+};
+
 // Image store.
 static std::unordered_map<std::filesystem::path, std::shared_ptr<Image>> g_ImageMap;
 
+// Texture store.
+static std::unordered_map<TextureKey, std::shared_ptr<Texture>> g_TextureMap;
+
 // Model store.
 static std::unordered_map<std::filesystem::path, std::shared_ptr<Model>> g_ModelMap;
 
@@ -63,6 +95,25 @@ std::shared_ptr<Image> ResourceManager::loadImage( const std::filesystem::path&
     return iter->second;
 }
 
+std::shared_ptr<Texture> ResourceManager::loadTexture( const std::filesystem::path& filePath, TextureLayout layout )
+{
+    TextureKey key { filePath, layout };
+    const auto iter = g_TextureMap.find( key );
+
+    if ( iter == g_TextureMap.end() )
+    {
+        // A texture without an image would not have any mip levels to sample from.
+        auto image   = loadImage( filePath );
+        auto texture = *image ? std::make_shared<Texture>( image, layout ) : nullptr;
+
+        g_TextureMap[key] = texture;
+
+        return texture;
+    }
+
+    return iter->second;
+}
+
 std::shared_ptr<SpriteSheet> ResourceManager::loadSpriteSheet( const std::filesystem::path& filePath, std::optional<uint32_t> spriteWidth, std::optional<uint32_t> spriteHeight, uint32_t padding, uint32_t margin, const BlendMode& blendMode )
 {
     auto image = loadImage( filePath );
@@ -104,6 +155,7 @@ std::shared_ptr<Font> ResourceManager::loadFont( const std::filesystem::path& fo
 void ResourceManager::clear()
 {
     g_ImageMap.clear();
+    g_TextureMap.clear();
     g_ModelMap.clear();
     g_FontMap.clear();
 }
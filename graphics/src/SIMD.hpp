@@ -0,0 +1,10 @@
+#pragma once
+
+// SSE2 is always available when targeting x86-64.
+// Define SR_NO_SIMD to force the scalar code paths.
+#if !defined( SR_NO_SIMD ) && ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+    #define SR_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define SR_SSE2 0
+#endif
@@ -0,0 +1,273 @@
+#include <Graphics/Sampler.hpp>
+
+#include "SIMD.hpp"
+
+#include <algorithm>
+#include <bit>
+
+using namespace Graphics;
+
+namespace
+{
+/// <summary>
+/// Round a float down to an integer (without a call to std::floor).
+/// </summary>
+inline int floorToInt( float x ) noexcept
+{
+    const int i = static_cast<int>( x );
+    return i - ( x < static_cast<float>( i ) ? 1 : 0 );
+}
+
+/// <summary>
+/// Approximate log2 of a positive float from its bit pattern (piecewise linear, the error is less than 0.09).
+/// This is accurate enough to select a mip level.
+/// </summary>
+inline float fastLog2( float x ) noexcept
+{
+    return static_cast<float>( std::bit_cast<int32_t>( x ) ) * ( 1.0f / ( 1 << 23 ) ) - 127.0f;
+}
+
+/// <summary>
+/// Wrap a texture coordinate to the range [0..1] (only with AddressMode::Wrap).
+/// Then the texel coordinates of a sample are at most one texel outside of the texture
+/// and they can be wrapped without an integer division.
+/// </summary>
+template<AddressMode Mode>
+inline float wrap( float u ) noexcept
+{
+    if constexpr ( Mode == AddressMode::Wrap )
+        return u - static_cast<float>( floorToInt( u ) );
+    else
+        return u;
+}
+
+/// <summary>
+/// Apply the address mode to an integer texel coordinate.
+/// </summary>
+template<AddressMode Mode>
+inline int address( int x, int size ) noexcept
+{
+    if constexpr ( Mode == AddressMode::Wrap )
+    {
+        // Power-of-two sizes are wrapped with a bitmask.
+        if ( ( size & ( size - 1 ) ) == 0 )
+            return x & ( size - 1 );
+
+        // The texture coordinate was already wrapped, so x is in the range [-1..size + 1].
+        return x < 0 ? x + size : ( x >= size ? x - size : x );
+    }
+    else if constexpr ( Mode == AddressMode::Mirror )
+    {
+        const int period = size * 2;
+
+        int t = x % period;
+        t     = t < 0 ? t + period : t;
+
+        return t < size ? t : period - 1 - t;
+    }
+    else
+    {
+        return std::clamp( x, 0, size - 1 );
+    }
+}
+
+/// <summary>
+/// Select the nearest mip level for a level of detail.
+/// </summary>
+inline uint32_t nearestLevel( float lod, uint32_t maxLevel ) noexcept
+{
+    // Also handles NaN (for example, if the derivatives are 0).
+    if ( !( lod > 0.5f ) )
+        return 0u;
+
+    return std::min( static_cast<uint32_t>( lod + 0.5f ), maxLevel );
+}
+
+/// <summary>
+/// Linear interpolation between two colors with an 8-bit weight.
+/// </summary>
+/// <param name="a">The first color.</param>
+/// <param name="b">The second color.</param>
+/// <param name="f">The weight of b in the range [0..256].</param>
+inline Color lerp( const Color& a, const Color& b, int f ) noexcept
+{
+#if SR_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ca   = _mm_unpacklo_epi8( _mm_cvtsi32_si128( static_cast<int>( std::bit_cast<uint32_t>( a ) ) ), zero );
+    const __m128i cb   = _mm_unpacklo_epi8( _mm_cvtsi32_si128( static_cast<int>( std::bit_cast<uint32_t>( b ) ) ), zero );
+    const __m128i c    = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( ca, _mm_set1_epi16( static_cast<short>( 256 - f ) ) ), _mm_mullo_epi16( cb, _mm_set1_epi16( static_cast<short>( f ) ) ) ), 8 );
+
+    return std::bit_cast<Color>( static_cast<uint32_t>( _mm_cvtsi128_si32( _mm_packus_epi16( c, c ) ) ) );
+#else
+    const auto channel = [f]( uint8_t x, uint8_t y ) {
+        return static_cast<uint8_t>( ( x * ( 256 - f ) + y * f ) >> 8 );
+    };
+
+    return Color { channel( a.r, b.r ), channel( a.g, b.g ), channel( a.b, b.b ), channel( a.a, b.a ) };
+#endif
+}
+
+/// <summary>
+/// Bilinear interpolation of 2x2 texels with 8-bit weights.
+/// </summary>
+/// <param name="c00">The top-left texel.</param>
+/// <param name="c10">The top-right texel.</param>
+/// <param name="c01">The bottom-left texel.</param>
+/// <param name="c11">The bottom-right texel.</param>
+/// <param name="fx">The horizontal weight in the range [0..256].</param>
+/// <param name="fy">The vertical weight in the range [0..256].</param>
+inline Color lerp( const Color& c00, const Color& c10, const Color& c01, const Color& c11, int fx, int fy ) noexcept
+{
+#if SR_SSE2
+    // Interpolate the top and bottom rows at the same time.
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i left  = _mm_unpacklo_epi8( _mm_set_epi32( 0, 0, static_cast<int>( std::bit_cast<uint32_t>( c01 ) ), static_cast<int>( std::bit_cast<uint32_t>( c00 ) ) ), zero );
+    const __m128i right = _mm_unpacklo_epi8( _mm_set_epi32( 0, 0, static_cast<int>( std::bit_cast<uint32_t>( c11 ) ), static_cast<int>( std::bit_cast<uint32_t>( c10 ) ) ), zero );
+    const __m128i rows  = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( left, _mm_set1_epi16( static_cast<short>( 256 - fx ) ) ), _mm_mullo_epi16( right, _mm_set1_epi16( static_cast<short>( fx ) ) ) ), 8 );
+    const __m128i c     = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( rows, _mm_set1_epi16( static_cast<short>( 256 - fy ) ) ), _mm_mullo_epi16( _mm_srli_si128( rows, 8 ), _mm_set1_epi16( static_cast<short>( fy ) ) ) ), 8 );
+
+    return std::bit_cast<Color>( static_cast<uint32_t>( _mm_cvtsi128_si32( _mm_packus_epi16( c, c ) ) ) );
+#else
+    return lerp( lerp( c00, c10, fx ), lerp( c01, c11, fx ), fy );
+#endif
+}
+
+/// <summary>
+/// Sample the nearest texel of a mip level.
+/// Texel i covers the texture coordinates [i / size, (i + 1) / size), so the centers of the texels
+/// of a mip level line up with the centers of the 2x2 texels of the previous level it was averaged from.
+/// </summary>
+template<AddressMode Mode>
+inline const Color& nearest( const Texture::MipLevel& level, const glm::vec2& uv ) noexcept
+{
+    const int w = static_cast<int>( level.width );
+    const int h = static_cast<int>( level.height );
+
+    const int x = address<Mode>( floorToInt( wrap<Mode>( uv.x ) * static_cast<float>( w ) ), w );
+    const int y = address<Mode>( floorToInt( wrap<Mode>( uv.y ) * static_cast<float>( h ) ), h );
+
+    return level( x, y );
+}
+
+/// <summary>
+/// Sample a mip level with bilinear filtering.
+/// </summary>
+template<AddressMode Mode>
+inline Color bilinear( const Texture::MipLevel& level, const glm::vec2& uv ) noexcept
+{
+    const int w = static_cast<int>( level.width );
+    const int h = static_cast<int>( level.height );
+
+    // The position relative to the center of the top-left texel.
+    const float x  = wrap<Mode>( uv.x ) * static_cast<float>( w ) - 0.5f;
+    const float y  = wrap<Mode>( uv.y ) * static_cast<float>( h ) - 0.5f;
+    const int   ix = floorToInt( x );
+    const int   iy = floorToInt( y );
+    const int   fx = static_cast<int>( ( x - static_cast<float>( ix ) ) * 256.0f );
+    const int   fy = static_cast<int>( ( y - static_cast<float>( iy ) ) * 256.0f );
+
+    const int x0 = address<Mode>( ix, w );
+    const int x1 = address<Mode>( ix + 1, w );
+    const int y0 = address<Mode>( iy, h );
+    const int y1 = address<Mode>( iy + 1, h );
+
+    return lerp( level( x0, y0 ), level( x1, y0 ), level( x0, y1 ), level( x1, y1 ), fx, fy );
+}
+
+/// <summary>
+/// Sample a texture with a filter and address mode.
+/// </summary>
+template<Filter F, AddressMode Mode>
+Color sampleTexture( const Texture& texture, const glm::vec2& uv, float lod ) noexcept
+{
+    const uint32_t maxLevel = texture.getNumMipLevels() - 1u;
+
+    if constexpr ( F == Filter::Nearest )
+    {
+        return nearest<Mode>( texture.getMipLevel( nearestLevel( lod, maxLevel ) ), uv );
+    }
+    else if constexpr ( F == Filter::Bilinear )
+    {
+        return bilinear<Mode>( texture.getMipLevel( nearestLevel( lod, maxLevel ) ), uv );
+    }
+    else
+    {
+        // Magnification, or the smallest mip level.
+        if ( !( lod > 0.0f ) )
+            return bilinear<Mode>( texture.getMipLevel( 0u ), uv );
+        if ( lod >= static_cast<float>( maxLevel ) )
+            return bilinear<Mode>( texture.getMipLevel( maxLevel ), uv );
+
+        const auto level = static_cast<uint32_t>( lod );
+        const int  f     = static_cast<int>( ( lod - static_cast<float>( level ) ) * 256.0f );
+
+        return lerp( bilinear<Mode>( texture.getMipLevel( level ), uv ), bilinear<Mode>( texture.getMipLevel( level + 1u ), uv ), f );
+    }
+}
+
+template<Filter F>
+Color sampleTexture( const Texture& texture, const glm::vec2& uv, float lod, AddressMode addressMode ) noexcept
+{
+    switch ( addressMode )
+    {
+    case AddressMode::Wrap:
+        return sampleTexture<F, AddressMode::Wrap>( texture, uv, lod );
+    case AddressMode::Mirror:
+        return sampleTexture<F, AddressMode::Mirror>( texture, uv, lod );
+    case AddressMode::Clamp:
+        return sampleTexture<F, AddressMode::Clamp>( texture, uv, lod );
+    }
+
+    return Color::Black;
+}
+}  // namespace
+
+float Sampler::getLOD( const Texture& texture, const glm::vec2& ddx, const glm::vec2& ddy ) const noexcept
+{
+    const float w = static_cast<float>( texture.getWidth() );
+    const float h = static_cast<float>( texture.getHeight() );
+
+    // The derivatives in texels per pixel.
+    const float dudx = ddx.x * w;
+    const float dvdx = ddx.y * h;
+    const float dudy = ddy.x * w;
+    const float dvdy = ddy.y * h;
+
+    // The level of detail is log2 of the largest scale factor.
+    // Source: OpenGL 4.6 Specification, 2022 (section 8.14.1).
+    const float rho2 = std::max( dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy );
+
+    return 0.5f * fastLog2( rho2 ) + lodBias;
+}
+
+Color Sampler::sample( const Texture& texture, const glm::vec2& uv, float lod ) const noexcept
+{
+    switch ( filter )
+    {
+    case Filter::Nearest:
+        return sampleTexture<Filter::Nearest>( texture, uv, lod, addressMode );
+    case Filter::Bilinear:
+        return sampleTexture<Filter::Bilinear>( texture, uv, lod, addressMode );
+    case Filter::Trilinear:
+        return sampleTexture<Filter::Trilinear>( texture, uv, lod, addressMode );
+    }
+
+    return Color::Black;
+}
+
+const Color& Sampler::sampleNearest( const Texture& texture, const glm::vec2& uv, float lod ) const noexcept
+{
+    const Texture::MipLevel& level = texture.getMipLevel( nearestLevel( lod, texture.getNumMipLevels() - 1u ) );
+
+    switch ( addressMode )
+    {
+    case AddressMode::Wrap:
+        return nearest<AddressMode::Wrap>( level, uv );
+    case AddressMode::Mirror:
+        return nearest<AddressMode::Mirror>( level, uv );
+    case AddressMode::Clamp:
+        break;
+    }
+
+    return nearest<AddressMode::Clamp>( level, uv );
+}
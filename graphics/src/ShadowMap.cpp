@@ -0,0 +1,389 @@
+#include <Graphics/ShadowMap.hpp>
+
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+using namespace Graphics;
+
+namespace
+{
+// The weight of the logarithmic split scheme (the uniform split scheme has the weight 1 - SplitLambda).
+// Source: Fan Zhang et al., "Parallel-Split Shadow Maps for Large-scale Virtual Environments", 2006.
+constexpr float SplitLambda = 0.75f;
+
+// The constant depth bias (in texels). The depth range of a cascade is the same as its width,
+// so the bias has the same size in all cascades. The slope of the shadow casters is handled by the slope-scaled bias.
+constexpr float DepthBias = 1.0f;
+
+/// <summary>
+/// Check if a bounding box is completely outside of the shadow map.
+/// The near side is not tested, since the shadow casters in front of a cascade still cast shadows into it.
+/// </summary>
+bool isOutside( const Math::AABB& aabb, const glm::mat4& shadowMatrix, float resolution ) noexcept
+{
+    glm::vec3 min { std::numeric_limits<float>::max() };
+    glm::vec3 max { std::numeric_limits<float>::lowest() };
+
+    for ( int i = 0; i < 8; ++i )
+    {
+        const glm::vec3 corner {
+            i & 1 ? aabb.max.x : aabb.min.x,
+            i & 2 ? aabb.max.y : aabb.min.y,
+            i & 4 ? aabb.max.z : aabb.min.z
+        };
+
+        const glm::vec3 p { shadowMatrix * glm::vec4 { corner, 1.0f } };
+
+        min = glm::min( min, p );
+        max = glm::max( max, p );
+    }
+
+    return max.x < 0.0f || max.y < 0.0f || min.x > resolution || min.y > resolution || min.z > 1.0f;
+}
+
+/// <summary>
+/// Rasterize a (two-sided) triangle into a depth buffer.
+/// The positions are in shadow map space: x and y in texels, and z is the depth.
+/// </summary>
+void rasterizeTriangle( Buffer<float>& depthBuffer, glm::vec3 p[3] )
+{
+    float area = ( p[1].x - p[0].x ) * ( p[2].y - p[0].y ) - ( p[2].x - p[0].x ) * ( p[1].y - p[0].y );
+
+    // Reject degenerate triangles (this also rejects NaN coordinates).
+    if ( !( std::abs( area ) > 0.0f ) )
+        return;
+
+    // Shadow casters are two-sided.
+    if ( area < 0.0f )
+    {
+        std::swap( p[1], p[2] );
+        area = -area;
+    }
+
+    const int size = static_cast<int>( depthBuffer.getWidth() );
+
+    // The texels whose center is inside of the bounds of the triangle.
+    const int minX = std::max( static_cast<int>( std::ceil( std::min( { p[0].x, p[1].x, p[2].x } ) - 0.5f ) ), 0 );
+    const int minY = std::max( static_cast<int>( std::ceil( std::min( { p[0].y, p[1].y, p[2].y } ) - 0.5f ) ), 0 );
+    const int maxX = std::min( static_cast<int>( std::floor( std::max( { p[0].x, p[1].x, p[2].x } ) - 0.5f ) ), size - 1 );
+    const int maxY = std::min( static_cast<int>( std::floor( std::max( { p[0].y, p[1].y, p[2].y } ) - 0.5f ) ), size - 1 );
+
+    if ( minX > maxX || minY > maxY )
+        return;
+
+    // Edge equations: E(x, y) = a * x + b * y + c >= 0 for points inside of the triangle.
+    float a[3], b[3], c[3];
+    for ( int i = 0; i < 3; ++i )
+    {
+        const glm::vec3& p0 = p[i];
+        const glm::vec3& p1 = p[( i + 1 ) % 3];
+
+        a[i] = p0.y - p1.y;
+        b[i] = p1.x - p0.x;
+        c[i] = -( a[i] * p0.x + b[i] * p0.y );
+    }
+
+    // The depth is linear in shadow map space: z(x, y) = z0 + dzdx * (x - x0) + dzdy * (y - y0).
+    const float dzdx = ( ( p[1].z - p[0].z ) * ( p[2].y - p[0].y ) - ( p[2].z - p[0].z ) * ( p[1].y - p[0].y ) ) / area;
+    const float dzdy = ( ( p[2].z - p[0].z ) * ( p[1].x - p[0].x ) - ( p[1].z - p[0].z ) * ( p[2].x - p[0].x ) ) / area;
+
+    // Slope-scaled depth bias: the depth of a texel is the farthest depth of the caster in the texel.
+    // Surfaces at a grazing angle to the light would otherwise shadow themselves (shadow acne).
+    const float slopeBias = 0.5f * ( std::abs( dzdx ) + std::abs( dzdy ) );
+
+    for ( int y = minY; y <= maxY; ++y )
+    {
+        const float py = static_cast<float>( y ) + 0.5f;
+
+        float* depthRow = &depthBuffer( 0, y );
+
+        for ( int x = minX; x <= maxX; ++x )
+        {
+            const float px = static_cast<float>( x ) + 0.5f;
+
+            if ( a[0] * px + b[0] * py + c[0] < 0.0f || a[1] * px + b[1] * py + c[1] < 0.0f || a[2] * px + b[2] * py + c[2] < 0.0f )
+                continue;
+
+            // Shadow casters in front of the cascade are flattened onto its near plane ("pancaking"),
+            // so the depth range of the cascade only needs to cover the receivers.
+            const float z = std::max( p[0].z + dzdx * ( px - p[0].x ) + dzdy * ( py - p[0].y ) + slopeBias, 0.0f );
+
+            depthRow[x] = std::min( depthRow[x], z );
+        }
+    }
+}
+}  // namespace
+
+ShadowMap::ShadowMap()
+: ShadowMap( DefaultResolution )
+{}
+
+ShadowMap::ShadowMap( std::size_t resolution, std::size_t numCascades )
+: resolution { resolution }
+, cascades( std::clamp<std::size_t>( numCascades, 1u, MaxCascades ) )
+{
+    for ( auto& cascade: cascades )
+    {
+        cascade.depthBuffer.resize( resolution, resolution );
+        cascade.depthBuffer.clear( 1.0f );
+    }
+
+    setLightDirection( lightDirection );
+}
+
+void ShadowMap::setLightDirection( const glm::vec3& direction ) noexcept
+{
+    lightDirection = glm::normalize( direction );
+
+    // The up vector can't be parallel to the light direction.
+    const glm::vec3 up = std::abs( lightDirection.y ) > 0.99f ? glm::vec3 { 0.0f, 0.0f, 1.0f } : glm::vec3 { 0.0f, 1.0f, 0.0f };
+
+    // The light is directional, so the light view only rotates.
+    lightViewMatrix = glm::lookAt( glm::vec3 { 0.0f }, lightDirection, up );
+}
+
+const glm::vec3& ShadowMap::getLightDirection() const noexcept
+{
+    return lightDirection;
+}
+
+void ShadowMap::setShadowDistance( float distance ) noexcept
+{
+    shadowDistance = distance;
+}
+
+float ShadowMap::getShadowDistance() const noexcept
+{
+    return shadowDistance;
+}
+
+void ShadowMap::setShadowStrength( float strength ) noexcept
+{
+    shadowStrength = std::clamp( strength, 0.0f, 1.0f );
+}
+
+float ShadowMap::getShadowStrength() const noexcept
+{
+    return shadowStrength;
+}
+
+void ShadowMap::update( const Math::Camera& camera )
+{
+    const glm::mat4 invProjectionMatrix = glm::inverse( camera.getProjectionMatrix() );
+    const glm::mat4 invViewMatrix       = glm::inverse( camera.getViewMatrix() );
+
+    // The corners of the near and far planes of the view frustum in view space.
+    glm::vec3 nearCorners[4];
+    glm::vec3 farCorners[4];
+    for ( int i = 0; i < 4; ++i )
+    {
+        const float x = i & 1 ? 1.0f : -1.0f;
+        const float y = i & 2 ? 1.0f : -1.0f;
+
+        const glm::vec4 n = invProjectionMatrix * glm::vec4 { x, y, -1.0f, 1.0f };
+        const glm::vec4 f = invProjectionMatrix * glm::vec4 { x, y, 1.0f, 1.0f };
+
+        nearCorners[i] = glm::vec3 { n } / n.w;
+        farCorners[i]  = glm::vec3 { f } / f.w;
+    }
+
+    const float nearDepth = -nearCorners[0].z;
+    const float farDepth  = -farCorners[0].z;
+    const float maxDepth  = shadowDistance > nearDepth ? std::min( shadowDistance, farDepth ) : farDepth;
+
+    const float numCascades = static_cast<float>( cascades.size() );
+    const float size        = static_cast<float>( resolution );
+
+    float splitNear = nearDepth;
+    for ( std::size_t c = 0; c < cascades.size(); ++c )
+    {
+        Cascade& cascade = cascades[c];
+
+        const float t            = static_cast<float>( c + 1 ) / numCascades;
+        const float logSplit     = nearDepth * std::pow( maxDepth / nearDepth, t );
+        const float uniformSplit = nearDepth + ( maxDepth - nearDepth ) * t;
+        const float splitFar     = SplitLambda * logSplit + ( 1.0f - SplitLambda ) * uniformSplit;
+
+        // The corners of the slice of the view frustum in world space.
+        glm::vec3 corners[8];
+        for ( int i = 0; i < 4; ++i )
+        {
+            const float tNear = ( splitNear - nearDepth ) / ( farDepth - nearDepth );
+            const float tFar  = ( splitFar - nearDepth ) / ( farDepth - nearDepth );
+
+            corners[i]     = glm::vec3 { invViewMatrix * glm::vec4 { glm::mix( nearCorners[i], farCorners[i], tNear ), 1.0f } };
+            corners[i + 4] = glm::vec3 { invViewMatrix * glm::vec4 { glm::mix( nearCorners[i], farCorners[i], tFar ), 1.0f } };
+        }
+
+        // Fit the cascade to the bounding sphere of the slice. The size of the sphere does not change when the camera rotates,
+        // and the center is snapped to the texel grid, so the shadow edges don't flicker when the camera moves.
+        glm::vec3 center { 0.0f };
+        for ( const glm::vec3& corner: corners )
+            center += corner;
+        center /= 8.0f;
+
+        float radius = 0.0f;
+        for ( const glm::vec3& corner: corners )
+            radius = std::max( radius, glm::length( corner - center ) );
+        radius = std::ceil( radius * 16.0f ) / 16.0f;
+
+        const float texelSize = 2.0f * radius / size;
+
+        glm::vec3 lightCenter { lightViewMatrix * glm::vec4 { center, 1.0f } };
+        lightCenter.x = std::floor( lightCenter.x / texelSize ) * texelSize;
+        lightCenter.y = std::floor( lightCenter.y / texelSize ) * texelSize;
+
+        // Light space to shadow map space: x and y in texels (y is flipped), and the depth (-z) in the range [0...1].
+        const float scale = size / ( 2.0f * radius );
+
+        cascade.scale  = { scale, -scale, -1.0f / ( 2.0f * radius ) };
+        cascade.offset = {
+            ( radius - lightCenter.x ) * scale,
+            ( radius + lightCenter.y ) * scale,
+            ( radius + lightCenter.z ) / ( 2.0f * radius )
+        };
+
+        glm::mat4 texelMatrix { 1.0f };
+        texelMatrix[0][0] = cascade.scale.x;
+        texelMatrix[1][1] = cascade.scale.y;
+        texelMatrix[2][2] = cascade.scale.z;
+        texelMatrix[3]    = glm::vec4 { cascade.offset, 1.0f };
+
+        cascade.shadowMatrix = texelMatrix * lightViewMatrix;
+        cascade.splitDepth   = splitFar;
+
+        splitNear = splitFar;
+    }
+}
+
+void ShadowMap::submit( const Mesh& mesh, const glm::mat4& modelMatrix )
+{
+    casters.push_back( { &mesh, modelMatrix } );
+}
+
+void ShadowMap::render()
+{
+    const int numCascades = static_cast<int>( cascades.size() );
+
+    // Each cascade has its own depth buffer, so the cascades are rendered in parallel.
+#pragma omp parallel for schedule( dynamic )
+    for ( int c = 0; c < numCascades; ++c )
+    {
+        renderCascade( cascades[c] );
+    }
+
+    casters.clear();
+}
+
+void ShadowMap::renderCascade( Cascade& cascade ) const
+{
+    const float size = static_cast<float>( resolution );
+
+    cascade.depthBuffer.clear( 1.0f );
+
+    std::vector<glm::vec3> positions;
+
+    for ( const auto& caster: casters )
+    {
+        const Mesh&     mesh         = *caster.mesh;
+        const glm::mat4 shadowMatrix = cascade.shadowMatrix * caster.modelMatrix;
+
+        if ( isOutside( mesh.getAABB(), shadowMatrix, size ) )
+            continue;
+
+        // Mesh must be triangulated.
+        assert( mesh.getNumIndices() % 3 == 0 );
+
+        const auto& meshPositions = mesh.getPositions();
+        const auto& indices       = mesh.getIndices();
+
+        // The transform is affine, so the vertices can be transformed to shadow map space directly.
+        positions.resize( meshPositions.size() );
+        for ( std::size_t i = 0; i < meshPositions.size(); ++i )
+            positions[i] = glm::vec3 { shadowMatrix * glm::vec4 { meshPositions[i], 1.0f } };
+
+        for ( const auto& meshlet: mesh.getMeshlets() )
+        {
+            if ( isOutside( meshlet.aabb, shadowMatrix, size ) )
+                continue;
+
+            const std::uint32_t lastIndex = meshlet.firstIndex + meshlet.indexCount;
+            for ( std::uint32_t i = meshlet.firstIndex; i + 2 < lastIndex; i += 3 )
+            {
+                glm::vec3 p[] = {
+                    positions[indices[i + 0]],
+                    positions[indices[i + 1]],
+                    positions[indices[i + 2]]
+                };
+
+                rasterizeTriangle( cascade.depthBuffer, p );
+            }
+        }
+    }
+}
+
+float ShadowMap::getLight( const glm::vec3& lightPosition ) const noexcept
+{
+    const float size = static_cast<float>( resolution );
+
+    for ( const auto& cascade: cascades )
+    {
+        const glm::vec3 p = lightPosition * cascade.scale + cascade.offset;
+
+        // Select the first cascade that contains the position (with a border for the filter).
+        if ( !( p.x >= 1.0f && p.x <= size - 1.0f && p.y >= 1.0f && p.y <= size - 1.0f && p.z <= 1.0f ) )
+            continue;
+
+        const float depth = p.z - DepthBias / size;
+
+        // 2x2 percentage-closer filter: the depth test results of the 4 nearest texels are filtered bilinearly.
+        const float x  = p.x - 0.5f;
+        const float y  = p.y - 0.5f;
+        const float x0 = std::floor( x );
+        const float y0 = std::floor( y );
+        const float fx = x - x0;
+        const float fy = y - y0;
+
+        const int ix = static_cast<int>( x0 );
+        const int iy = static_cast<int>( y0 );
+
+        const float* row0 = &cascade.depthBuffer( 0, iy );
+        const float* row1 = &cascade.depthBuffer( 0, iy + 1 );
+
+        const float s00 = depth <= row0[ix] ? 1.0f : 0.0f;
+        const float s10 = depth <= row0[ix + 1] ? 1.0f : 0.0f;
+        const float s01 = depth <= row1[ix] ? 1.0f : 0.0f;
+        const float s11 = depth <= row1[ix + 1] ? 1.0f : 0.0f;
+
+        const float top    = s00 + ( s10 - s00 ) * fx;
+        const float bottom = s01 + ( s11 - s01 ) * fx;
+        const float lit    = top + ( bottom - top ) * fy;
+
+        return 1.0f - shadowStrength * ( 1.0f - lit );
+    }
+
+    // Outside of the shadow map: the position is lit.
+    return 1.0f;
+}
+
+const glm::mat4& ShadowMap::getLightViewMatrix() const noexcept
+{
+    return lightViewMatrix;
+}
+
+std::size_t ShadowMap::getNumCascades() const noexcept
+{
+    return cascades.size();
+}
+
+const ShadowMap::Cascade& ShadowMap::getCascade( std::size_t i ) const noexcept
+{
+    assert( i < cascades.size() );
+    return cascades[i];
+}
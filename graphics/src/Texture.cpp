@@ -0,0 +1,113 @@
+#include <Graphics/Texture.hpp>
+
+#include <algorithm>
+
+using namespace Graphics;
+
+Texture::Texture() = default;
+
+Texture::Texture( std::shared_ptr<Image> _image, TextureLayout _layout )
+: image { std::move( _image ) }
+, layout { _layout }
+{
+    if ( image && *image )
+        generateMipMaps();
+}
+
+void Texture::generateMipMaps()
+{
+    // Generate the (row-major) mip levels 1 .. N.
+    std::vector<Image> images;
+
+    const Image* src = image.get();
+
+    while ( src->getWidth() > 1u || src->getHeight() > 1u )
+    {
+        const uint32_t srcWidth  = src->getWidth();
+        const uint32_t srcHeight = src->getHeight();
+        const uint32_t width     = std::max( srcWidth / 2u, 1u );
+        const uint32_t height    = std::max( srcHeight / 2u, 1u );
+
+        Image dst { width, height };
+
+        for ( uint32_t y = 0; y < height; ++y )
+        {
+            // Odd sizes: the last row (or column) is clamped to the edge of the image.
+            const uint32_t y0 = std::min( y * 2u, srcHeight - 1u );
+            const uint32_t y1 = std::min( y * 2u + 1u, srcHeight - 1u );
+
+            for ( uint32_t x = 0; x < width; ++x )
+            {
+                const uint32_t x0 = std::min( x * 2u, srcWidth - 1u );
+                const uint32_t x1 = std::min( x * 2u + 1u, srcWidth - 1u );
+
+                const Color& c00 = ( *src )( x0, y0 );
+                const Color& c10 = ( *src )( x1, y0 );
+                const Color& c01 = ( *src )( x0, y1 );
+                const Color& c11 = ( *src )( x1, y1 );
+
+                // Box filter (rounded to nearest).
+                dst( x, y ) = Color {
+                    static_cast<uint8_t>( ( c00.r + c10.r + c01.r + c11.r + 2u ) / 4u ),
+                    static_cast<uint8_t>( ( c00.g + c10.g + c01.g + c11.g + 2u ) / 4u ),
+                    static_cast<uint8_t>( ( c00.b + c10.b + c01.b + c11.b + 2u ) / 4u ),
+                    static_cast<uint8_t>( ( c00.a + c10.a + c01.a + c11.a + 2u ) / 4u )
+                };
+            }
+        }
+
+        images.push_back( std::move( dst ) );
+        src = &images.back();
+    }
+
+    const auto getImage = [this, &images]( std::size_t level ) -> const Image& {
+        return level == 0 ? *image : images[level - 1];
+    };
+
+    const uint32_t tileShift = layout == TextureLayout::Tiled ? TileShift : 0u;
+    const uint32_t tileSize  = 1u << tileShift;
+
+    // Allocate the texels of all mip levels (the tiles at the right and bottom edges are padded).
+    std::vector<std::size_t> offsets;
+    std::size_t              numTexels = 0;
+
+    mipLevels.clear();
+    for ( std::size_t level = 0; level <= images.size(); ++level )
+    {
+        const Image& levelImage = getImage( level );
+
+        MipLevel mipLevel;
+        mipLevel.width     = levelImage.getWidth();
+        mipLevel.height    = levelImage.getHeight();
+        mipLevel.tilesX    = ( mipLevel.width + tileSize - 1u ) >> tileShift;
+        mipLevel.tileShift = tileShift;
+
+        const uint32_t tilesY = ( mipLevel.height + tileSize - 1u ) >> tileShift;
+
+        mipLevels.push_back( mipLevel );
+        offsets.push_back( numTexels );
+        numTexels += ( static_cast<std::size_t>( mipLevel.tilesX ) * tilesY ) << ( tileShift * 2u );
+    }
+
+    // Round up to a whole number of cache lines.
+    numTexels = ( numTexels + 15u ) & ~std::size_t { 15u };
+    texels    = make_aligned_unique<Color[], 64>( numTexels );
+
+    // Convert the mip levels to the layout of the texture.
+    for ( std::size_t level = 0; level < mipLevels.size(); ++level )
+    {
+        const Image& levelImage = getImage( level );
+        MipLevel&    mipLevel   = mipLevels[level];
+        Color*       dst        = texels.get() + offsets[level];
+
+        for ( uint32_t y = 0; y < mipLevel.height; ++y )
+        {
+            for ( uint32_t x = 0; x < mipLevel.width; ++x )
+            {
+                dst[mipLevel.index( x, y )] = levelImage( x, y );
+            }
+        }
+
+        mipLevel.texels = dst;
+    }
+}
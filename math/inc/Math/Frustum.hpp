@@ -0,0 +1,102 @@
+#pragma once
+
+#include "AABB.hpp"
+#include "Plane.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cmath>
+
+namespace Math
+{
+/// <summary>
+/// The result of a containment test.
+/// </summary>
+enum class Containment
+{
+    Outside,    // Completely outside.
+    Inside,     // Completely inside.
+    Intersect,  // Partially inside.
+};
+
+struct Frustum
+{
+    enum Side
+    {
+        Left,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        NumSides
+    };
+
+    Frustum() = default;
+
+    /// <summary>
+    /// Extract the frustum planes from a projection matrix.
+    /// If the matrix is the view-projection matrix, the planes are in world space.
+    /// If the matrix is the model-view-projection matrix, the planes are in object space.
+    /// Source: Gil Gribb and Klaus Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix" (2001).
+    /// </summary>
+    /// <param name="m">The (model-)view-projection matrix.</param>
+    explicit Frustum( const glm::mat4& m ) noexcept
+    {
+        const glm::vec4 r0 { m[0][0], m[1][0], m[2][0], m[3][0] };
+        const glm::vec4 r1 { m[0][1], m[1][1], m[2][1], m[3][1] };
+        const glm::vec4 r2 { m[0][2], m[1][2], m[2][2], m[3][2] };
+        const glm::vec4 r3 { m[0][3], m[1][3], m[2][3], m[3][3] };
+
+        planes[Left]   = makePlane( r3 + r0 );
+        planes[Right]  = makePlane( r3 - r0 );
+        planes[Bottom] = makePlane( r3 + r1 );
+        planes[Top]    = makePlane( r3 - r1 );
+        planes[Near]   = makePlane( r3 + r2 );
+        planes[Far]    = makePlane( r3 - r2 );
+    }
+
+    /// <summary>
+    /// Test an axis-aligned bounding box against the frustum.
+    /// Source: Real-time Collision Detection, Christer Ericson (2005)
+    /// </summary>
+    /// <param name="aabb">The AABB to test.</param>
+    /// <returns>Whether the AABB is outside, inside, or intersecting the frustum.</returns>
+    Containment contains( const AABB& aabb ) const noexcept
+    {
+        const glm::vec3 c = aabb.center();  // AABB center point.
+        const glm::vec3 e = aabb.max - c;   // AABB extents.
+
+        Containment result = Containment::Inside;
+
+        for ( const Plane& p: planes )
+        {
+            // The projected radius of the AABB onto the plane normal.
+            const float r = e.x * std::abs( p.n.x ) + e.y * std::abs( p.n.y ) + e.z * std::abs( p.n.z );
+            const float s = p.distance( c );
+
+            if ( s < -r )
+                return Containment::Outside;
+            if ( s < r )
+                result = Containment::Intersect;
+        }
+
+        return result;
+    }
+
+    /// <summary>
+    /// The frustum planes. The plane normals point to the inside of the frustum.
+    /// </summary>
+    Plane planes[NumSides];
+
+private:
+    static Plane makePlane( const glm::vec4& p ) noexcept
+    {
+        const glm::vec3 n { p.x, p.y, p.z };
+        const float     l = glm::length( n );
+
+        return { n / l, -p.w / l };
+    }
+};
+}  // namespace Math
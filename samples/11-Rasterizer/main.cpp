@@ -5,6 +5,7 @@
 #include <Graphics/Input.hpp>
 #include <Graphics/Model.hpp>
 #include <Graphics/Rasterizer.hpp>
+#include <Graphics/ShadowMap.hpp>
 #include <Graphics/Timer.hpp>
 #include <Graphics/Window.hpp>
 
@@ -15,6 +16,7 @@
 #include <glm/gtx/transform.hpp>
 
 #include <fmt/core.h>
+#include <future>
 #include <iostream>
 
 #include <imgui.h>
@@ -41,7 +43,6 @@ int main( int argc, char* argv[] )
     const int WINDOW_HEIGHT = 1080;
 
     Viewport viewport { 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT };
-    Image    image { WINDOW_WIDTH, WINDOW_HEIGHT };
 
     CameraController camera { { 0, 3, 0 }, 0.0f, 90.0f };
     camera.setPerspective( 60.0f, static_cast<float>( WINDOW_WIDTH ) / WINDOW_HEIGHT, 0.1f, 100.0f );
@@ -50,7 +51,18 @@ int main( int argc, char* argv[] )
     rasterizer.setCamera( &camera.getCamera() );
     rasterizer.setViewport( viewport );
 
-    Model model { "assets/models/sponza.obj" };
+    // Frame N is presented on the main thread while frame N+1 is rendered into the second render target.
+    rasterizer.setNumRenderTargets( 2 );
+
+    // The shadow cascades cover the first 30 meters in front of the camera.
+    ShadowMap shadowMap;
+    shadowMap.setLightDirection( { 0.3f, -1.0f, 0.2f } );
+    shadowMap.setShadowDistance( 30.0f );
+
+    bool shadows = true;
+
+    // Generate 3 levels of detail for the meshes of the model.
+    Model model { "assets/models/sponza.obj", 3 };
 
     Window window { "11 - Rasterizer", WINDOW_WIDTH, WINDOW_HEIGHT };
 
@@ -64,6 +76,10 @@ int main( int argc, char* argv[] )
 
     float angle = 90.0f;
 
+    // The frame that is presented, and the statistics of that frame.
+    Rasterizer::Frame*     frame = nullptr;
+    Rasterizer::Statistics statistics;
+
     while ( window )
     {
         timer.tick();
@@ -71,19 +87,56 @@ int main( int argc, char* argv[] )
 
         camera.update( static_cast<float>( timer.elapsedSeconds() ) );
 
-        rasterizer.clear( Color::Black, 1.0f );
+        // Render the next frame on a worker thread.
+        auto nextFrame = std::async( std::launch::async, [&]() -> Rasterizer::Frame& {
+            rasterizer.clear( Color::Black, 1.0f );
+
+            const glm::mat4 modelMatrix = glm::scale( glm::vec3 { 0.01f } );
+
+            // The shadow map must be rendered before the meshes are shaded.
+            if ( shadows )
+            {
+                shadowMap.update( camera.getCamera() );
+
+                for ( const auto& mesh: model.getMeshes() )
+                {
+                    shadowMap.submit( *mesh, modelMatrix );
+                }
+
+                shadowMap.render();
+            }
+
+            rasterizer.setShadowMap( shadows ? &shadowMap : nullptr );
+
+            for ( const auto& mesh: model.getMeshes() )
+            {
+                rasterizer.submit( *mesh, modelMatrix );
+            }
+
+            rasterizer.flush();
+            rasterizer.resolve();
 
-        const glm::mat4 modelMatrix = glm::scale( glm::vec3 { 0.01f } );
+            return rasterizer.present();
+        } );
 
-        for ( const auto& mesh: model.getMeshes() )
+        // Present the previous frame while the next frame is rendered.
+        // The frame owns its render target until its fence is signaled, so the text is drawn directly into it.
+        if ( frame )
         {
-            rasterizer.draw( *mesh, modelMatrix );
-        }
+            Image& image = frame->image;
+
+            image.drawText( Font::Default, fps, 10, 10, Color::White );
+            image.drawText( Font::Default, fmt::format( "Meshes  : {} drawn, {} culled", statistics.meshesDrawn, statistics.meshesCulled ), 10, 30, Color::White );
+            image.drawText( Font::Default, fmt::format( "Triangles: {} submitted, {} clipped, {} culled, {} rasterized", statistics.trianglesSubmitted, statistics.trianglesClipped, statistics.trianglesCulled, statistics.trianglesRasterized ), 10, 50, Color::White );
+            image.drawText( Font::Default, fmt::format( "Pixels  : {} tested, {} passed, {} written", statistics.pixelsTested, statistics.pixelsPassed, statistics.pixelsWritten ), 10, 70, Color::White );
+            image.drawText( Font::Default, fmt::format( "Time (ms): vertex {:.2f}, clip {:.2f}, setup {:.2f}, raster {:.2f}, shade {:.2f}", statistics.vertexTime, statistics.clipTime, statistics.setupTime, statistics.rasterTime, statistics.shadeTime ), 10, 90, Color::White );
 
-        image.copy( rasterizer.getImage() );
-        image.drawText( Font::Default, fps, 10, 10, Color::White );
+            window.present( image );
+            frame->fence.signal();
+        }
 
-        window.present( image );
+        frame      = &nextFrame.get();
+        statistics = rasterizer.getStatistics();
 
         Event e;
         while ( window.popEvent( e ) )
@@ -102,6 +155,12 @@ int main( int argc, char* argv[] )
                 case KeyCode::Escape:
                     window.destroy();
                     break;
+                case KeyCode::L:
+                    shadows = !shadows;
+                    break;
+                case KeyCode::M:
+                    rasterizer.setMultisampling( !rasterizer.getMultisampling() );
+                    break;
                 case KeyCode::V:
                     window.toggleVSync();
                     break;
@@ -0,0 +1,558 @@
+// Render a model offline (without a window) and report the frame times and the pipeline statistics as JSON.
+//
+// Usage: 13-Headless [options]
+//   -cwd <path>           Set the working directory.
+//   -obj <path>           The model to render (default: assets/models/sponza.obj).
+//   -camera <path>        The camera path (default: orbit around the model).
+//   -width <pixels>       The width of the render target (default: 1920).
+//   -height <pixels>      The height of the render target (default: 1080).
+//   -frames <count>       The number of frames to render (default: 100).
+//   -lods <count>         The number of levels of detail to generate for the meshes (default: 0).
+//   -msaa                 Enable multisampling.
+//   -visibility           Shade with a visibility buffer instead of forward shading.
+//   -tiled                Store the textures of the model in the tiled layout (see TextureLayout).
+//   -save <prefix>        Save the rendered frames to <prefix><frame>.png.
+//   -save-frames <list>   A comma-separated list of the frames to save (default: all frames).
+//   -o <path>             Write the report to a file instead of the standard output.
+//   -texture <path>       Also measure the texel fetches of a texture in the linear and the tiled layout.
+//
+// The camera path is a text file with one key frame per line: the position of the camera and the position it looks at
+// ("x y z tx ty tz"). Lines that start with '#' are ignored. The key frames are spread evenly over the rendered frames.
+
+#include <Graphics/Image.hpp>
+#include <Graphics/Model.hpp>
+#include <Graphics/Rasterizer.hpp>
+#include <Graphics/Sampler.hpp>
+#include <Graphics/Texture.hpp>
+#include <Graphics/Timer.hpp>
+
+#include <Math/Camera3D.hpp>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Graphics;
+using namespace Math;
+
+struct KeyFrame
+{
+    glm::vec3 position;
+    glm::vec3 target;
+};
+
+// Read the key frames of a camera path.
+std::vector<KeyFrame> loadCameraPath( const std::filesystem::path& file )
+{
+    std::vector<KeyFrame> keyFrames;
+
+    std::ifstream stream { file };
+    if ( !stream )
+    {
+        std::cerr << "ERROR: Failed to open camera path: " << file << std::endl;
+        return keyFrames;
+    }
+
+    std::string line;
+    while ( std::getline( stream, line ) )
+    {
+        if ( line.empty() || line[0] == '#' )
+            continue;
+
+        std::istringstream ss { line };
+        KeyFrame           keyFrame {};
+        if ( ss >> keyFrame.position.x >> keyFrame.position.y >> keyFrame.position.z >> keyFrame.target.x >> keyFrame.target.y >> keyFrame.target.z )
+        {
+            keyFrames.push_back( keyFrame );
+        }
+        else
+        {
+            std::cerr << "WARNING: Invalid camera key frame: " << line << std::endl;
+        }
+    }
+
+    return keyFrames;
+}
+
+// Get the camera of a frame by linearly interpolating the key frames.
+KeyFrame interpolateCameraPath( const std::vector<KeyFrame>& keyFrames, int frame, int numFrames )
+{
+    if ( keyFrames.size() == 1 || numFrames < 2 )
+        return keyFrames.front();
+
+    const float       t = static_cast<float>( frame ) / static_cast<float>( numFrames - 1 ) * static_cast<float>( keyFrames.size() - 1 );
+    const std::size_t i = std::min( static_cast<std::size_t>( t ), keyFrames.size() - 2 );
+    const float       s = t - static_cast<float>( i );
+
+    return {
+        glm::mix( keyFrames[i].position, keyFrames[i + 1].position, s ),
+        glm::mix( keyFrames[i].target, keyFrames[i + 1].target, s )
+    };
+}
+
+// Parse a comma-separated list of frame numbers.
+// Returns an empty optional if an entry of the list is not a frame number.
+std::optional<std::vector<int>> parseFrameList( const std::string& list )
+{
+    std::vector<int> frames;
+
+    std::istringstream ss { list };
+    std::string        frame;
+    while ( std::getline( ss, frame, ',' ) )
+    {
+        if ( frame.empty() )
+            continue;
+
+        const char* end   = frame.data() + frame.size();
+        int         value = 0;
+        if ( const auto result = std::from_chars( frame.data(), end, value ); result.ec != std::errc {} || result.ptr != end )
+        {
+            std::cerr << "ERROR: Invalid frame number: " << frame << std::endl;
+            return std::nullopt;
+        }
+
+        frames.push_back( value );
+    }
+
+    return frames;
+}
+
+// The result of the texel fetch benchmark for one texture layout.
+struct TextureFetchResult
+{
+    double uAlongX      = 0.0;  // Nanoseconds per fetch when the u axis of the texture runs along the screen x-axis.
+    double vAlongX      = 0.0;  // Nanoseconds per fetch when the v axis of the texture runs along the screen x-axis.
+    double missUAlongX  = 0.0;  // Simulated cache misses per fetch when the u axis of the texture runs along the screen x-axis.
+    double missVAlongX  = 0.0;  // Simulated cache misses per fetch when the v axis of the texture runs along the screen x-axis.
+};
+
+// Simulate the texel fetches of measureTextureFetch with a 32 KiB, 8-way set-associative cache with LRU replacement
+// (the size of a typical L1 data cache) and count the cache misses per fetch.
+// This is a proxy for the cache miss rate that doesn't depend on the timer (the other data in the cache is ignored).
+double simulateCacheMisses( const Texture& texture, int width, int height, bool transposed )
+{
+    constexpr int            BlockSize = 8;
+    constexpr std::uintptr_t LineSize  = 64;
+    constexpr std::size_t    NumWays   = 8;
+    constexpr std::size_t    NumSets   = 32 * 1024 / LineSize / NumWays;
+
+    // The cache lines of each set, from the most to the least recently used.
+    std::vector<std::array<std::uintptr_t, NumWays>> sets( NumSets );
+    for ( auto& set: sets )
+        set.fill( std::numeric_limits<std::uintptr_t>::max() );
+
+    std::size_t misses = 0;
+
+    const auto access = [&]( const Color* texel ) {
+        const auto line = reinterpret_cast<std::uintptr_t>( texel ) / LineSize;
+        auto&      set  = sets[line % NumSets];
+
+        auto iter = std::find( set.begin(), set.end(), line );
+        if ( iter == set.end() )
+        {
+            // Replace the least recently used line.
+            ++misses;
+            iter = set.end() - 1;
+        }
+
+        std::rotate( set.begin(), iter, iter + 1 );
+        set.front() = line;
+    };
+
+    const Texture::MipLevel& mip = texture.getMipLevel( 0 );
+
+    for ( int by = 0; by < height; by += BlockSize )
+    {
+        for ( int bx = 0; bx < width; bx += BlockSize )
+        {
+            for ( int y = by; y < std::min( by + BlockSize, height ); ++y )
+            {
+                for ( int x = bx; x < std::min( bx + BlockSize, width ); ++x )
+                {
+                    const int tx = transposed ? y : x;
+                    const int ty = transposed ? x : y;
+
+                    // The 2x2 texels of the bilinear footprint (the texture wraps).
+                    for ( int i = 0; i < 4; ++i )
+                    {
+                        const auto u = static_cast<uint32_t>( tx + ( i & 1 ) ) % mip.width;
+                        const auto v = static_cast<uint32_t>( ty + ( i >> 1 ) ) % mip.height;
+
+                        access( &mip( u, v ) );
+                    }
+                }
+            }
+        }
+    }
+
+    return static_cast<double>( misses ) / ( static_cast<double>( width ) * height );
+}
+
+// Measure the time of a bilinear texel fetch from the first mip level of a texture.
+// The texture is sampled at 1:1 (one texel per pixel) for each pixel of a width x height screen, in the 8x8 pixel
+// blocks of the rasterizer. The fastest of a few passes is used to reduce the noise.
+// The simulated cache misses per fetch (see simulateCacheMisses) are reported next to the time.
+TextureFetchResult measureTextureFetch( const Texture& texture, int width, int height )
+{
+    constexpr int BlockSize = 8;
+    constexpr int NumPasses = 5;
+
+    Sampler sampler;
+    sampler.filter = Filter::Bilinear;
+
+    const glm::vec2 texelSize = 1.0f / glm::vec2 { static_cast<float>( texture.getWidth() ), static_cast<float>( texture.getHeight() ) };
+
+    // The checksum is written to a volatile variable, so the compiler can't remove the fetches.
+    std::uint32_t checksum = 0u;
+
+    auto measure = [&]( bool transposed ) {
+        double best = std::numeric_limits<double>::max();
+
+        for ( int pass = 0; pass < NumPasses; ++pass )
+        {
+            Timer timer;
+
+            for ( int by = 0; by < height; by += BlockSize )
+            {
+                for ( int bx = 0; bx < width; bx += BlockSize )
+                {
+                    for ( int y = by; y < std::min( by + BlockSize, height ); ++y )
+                    {
+                        for ( int x = bx; x < std::min( bx + BlockSize, width ); ++x )
+                        {
+                            const glm::vec2 texel = transposed ? glm::vec2 { y, x } : glm::vec2 { x, y };
+                            const Color     color = sampler.sample( texture, ( texel + 0.5f ) * texelSize, 0.0f );
+
+                            checksum += color.r;
+                        }
+                    }
+                }
+            }
+
+            timer.tick();
+            best = std::min( best, timer.elapsedMicroseconds() * 1000.0 / ( static_cast<double>( width ) * height ) );
+        }
+
+        return best;
+    };
+
+    TextureFetchResult result;
+    result.uAlongX      = measure( false );
+    result.vAlongX      = measure( true );
+    result.missUAlongX  = simulateCacheMisses( texture, width, height, false );
+    result.missVAlongX  = simulateCacheMisses( texture, width, height, true );
+
+    volatile std::uint32_t sink = checksum;
+    static_cast<void>( sink );
+
+    return result;
+}
+
+// Get the p-th percentile of the sorted values (nearest-rank method).
+double percentile( const std::vector<double>& sortedValues, double p )
+{
+    const auto rank = static_cast<std::size_t>( std::ceil( p / 100.0 * static_cast<double>( sortedValues.size() ) ) );
+    return sortedValues[std::clamp<std::size_t>( rank, 1u, sortedValues.size() ) - 1u];
+}
+
+// Escape a string to be used in JSON.
+std::string escapeJSON( const std::string& str )
+{
+    std::string escaped;
+    for ( char c: str )
+    {
+        switch ( c )
+        {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        default:
+            // Control characters must be escaped.
+            if ( static_cast<unsigned char>( c ) < 0x20 )
+                escaped += fmt::format( "\\u{:04x}", static_cast<int>( c ) );
+            else
+                escaped += c;
+            break;
+        }
+    }
+    return escaped;
+}
+
+int main( int argc, char* argv[] )
+{
+    std::filesystem::path modelFile = "assets/models/sponza.obj";
+    std::filesystem::path cameraFile;
+    std::filesystem::path savePrefix;
+    std::filesystem::path outputFile;
+    std::filesystem::path textureFile;
+    std::vector<int>      saveFrames;
+    TextureLayout         textureLayout = TextureLayout::Linear;
+
+    int  width       = 1920;
+    int  height      = 1080;
+    int  numFrames   = 100;
+    int  numLODs     = 0;
+    bool multisample = false;
+    bool visibility  = false;
+
+    // Parse command-line arguments.
+    for ( int i = 1; i < argc; ++i )
+    {
+        const bool hasValue = i + 1 < argc;
+
+        if ( strcmp( argv[i], "-cwd" ) == 0 && hasValue )
+        {
+            std::string workingDirectory = argv[++i];
+            std::filesystem::current_path( workingDirectory );
+        }
+        else if ( strcmp( argv[i], "-obj" ) == 0 && hasValue )
+            modelFile = argv[++i];
+        else if ( strcmp( argv[i], "-camera" ) == 0 && hasValue )
+            cameraFile = argv[++i];
+        else if ( strcmp( argv[i], "-width" ) == 0 && hasValue )
+            width = std::atoi( argv[++i] );
+        else if ( strcmp( argv[i], "-height" ) == 0 && hasValue )
+            height = std::atoi( argv[++i] );
+        else if ( strcmp( argv[i], "-frames" ) == 0 && hasValue )
+            numFrames = std::atoi( argv[++i] );
+        else if ( strcmp( argv[i], "-lods" ) == 0 && hasValue )
+            numLODs = std::atoi( argv[++i] );
+        else if ( strcmp( argv[i], "-msaa" ) == 0 )
+            multisample = true;
+        else if ( strcmp( argv[i], "-visibility" ) == 0 )
+            visibility = true;
+        else if ( strcmp( argv[i], "-tiled" ) == 0 )
+            textureLayout = TextureLayout::Tiled;
+        else if ( strcmp( argv[i], "-save" ) == 0 && hasValue )
+            savePrefix = argv[++i];
+        else if ( strcmp( argv[i], "-save-frames" ) == 0 && hasValue )
+        {
+            auto frames = parseFrameList( argv[++i] );
+            if ( !frames )
+                return 1;
+
+            saveFrames = std::move( *frames );
+        }
+        else if ( strcmp( argv[i], "-o" ) == 0 && hasValue )
+            outputFile = argv[++i];
+        else if ( strcmp( argv[i], "-texture" ) == 0 && hasValue )
+            textureFile = argv[++i];
+        else
+            std::cerr << "WARNING: Unknown argument: " << argv[i] << std::endl;
+    }
+
+    if ( width <= 0 || height <= 0 || numFrames <= 0 || numLODs < 0 )
+    {
+        std::cerr << "ERROR: Invalid resolution, frame count, or number of LODs." << std::endl;
+        return 1;
+    }
+
+    Model model { modelFile, static_cast<std::size_t>( numLODs ), textureLayout };
+    if ( model.getMeshes().empty() )
+    {
+        std::cerr << "ERROR: Failed to load model: " << modelFile << std::endl;
+        return 1;
+    }
+
+    const AABB&     aabb   = model.getAABB();
+    const glm::vec3 center = aabb.center();
+    const float     radius = glm::length( aabb.max - aabb.min ) * 0.5f;
+
+    std::vector<KeyFrame> cameraPath;
+    if ( !cameraFile.empty() )
+    {
+        cameraPath = loadCameraPath( cameraFile );
+        if ( cameraPath.empty() )
+        {
+            std::cerr << "ERROR: The camera path does not contain any key frames: " << cameraFile << std::endl;
+            return 1;
+        }
+    }
+
+    // Texture fetch benchmark: compare the linear and the tiled layout of the texture.
+    std::shared_ptr<Image> textureImage;
+    TextureFetchResult     linearFetch;
+    TextureFetchResult     tiledFetch;
+    if ( !textureFile.empty() )
+    {
+        textureImage = std::make_shared<Image>( textureFile );
+        if ( !*textureImage )
+        {
+            std::cerr << "ERROR: Failed to load texture: " << textureFile << std::endl;
+            return 1;
+        }
+
+        linearFetch = measureTextureFetch( Texture { textureImage, TextureLayout::Linear }, width, height );
+        tiledFetch  = measureTextureFetch( Texture { textureImage, TextureLayout::Tiled }, width, height );
+    }
+
+    // The clipping planes are derived from the size of the model, so that any model fits in the view.
+    Camera camera;
+    camera.setProjection( glm::radians( 60.0f ), static_cast<float>( width ) / static_cast<float>( height ), radius * 0.001f, radius * 4.0f );
+
+    Rasterizer rasterizer( width, height );
+    rasterizer.setCamera( &camera );
+    rasterizer.setViewport( { 0, 0, static_cast<float>( width ), static_cast<float>( height ) } );
+    rasterizer.setMultisampling( multisample );
+    rasterizer.setShadingMode( visibility ? Rasterizer::ShadingMode::VisibilityBuffer : Rasterizer::ShadingMode::Forward );
+
+    const glm::mat4 modelMatrix { 1.0f };
+
+    std::vector<double>    frameTimes;
+    Rasterizer::Statistics totalStatistics;
+    Timer                  timer;
+
+    frameTimes.reserve( numFrames );
+
+    for ( int frame = 0; frame < numFrames; ++frame )
+    {
+        KeyFrame keyFrame;
+        if ( !cameraPath.empty() )
+        {
+            keyFrame = interpolateCameraPath( cameraPath, frame, numFrames );
+        }
+        else
+        {
+            // Orbit around the model.
+            const float angle = glm::two_pi<float>() * static_cast<float>( frame ) / static_cast<float>( numFrames );
+            keyFrame.position = center + glm::vec3 { std::cos( angle ), 0.5f, std::sin( angle ) } * radius * 1.5f;
+            keyFrame.target   = center;
+        }
+        camera.lookAt( keyFrame.position, keyFrame.target );
+
+        timer.tick();
+
+        rasterizer.clear( Color::Black, 1.0f );
+
+        for ( const auto& mesh: model.getMeshes() )
+        {
+            rasterizer.submit( *mesh, modelMatrix );
+        }
+
+        rasterizer.flush();
+        rasterizer.resolve();
+
+        timer.tick();
+
+        frameTimes.push_back( timer.elapsedMilliseconds() );
+        totalStatistics += rasterizer.getStatistics();
+
+        if ( !savePrefix.empty() && ( saveFrames.empty() || std::ranges::find( saveFrames, frame ) != saveFrames.end() ) )
+        {
+            rasterizer.getImage().save( fmt::format( "{}{:04}.png", savePrefix.string(), frame ) );
+        }
+    }
+
+    std::vector<double> sortedFrameTimes = frameTimes;
+    std::ranges::sort( sortedFrameTimes );
+
+    double totalTime = 0.0;
+    for ( double t: frameTimes )
+        totalTime += t;
+
+    // The pipeline statistics are averaged over the frames.
+    const auto  n   = static_cast<double>( numFrames );
+    const auto& s   = totalStatistics;
+    const auto  avg = [n]( auto value ) { return static_cast<double>( value ) / n; };
+
+    std::string report;
+    report += "{\n";
+    report += fmt::format( "  \"model\": \"{}\",\n", escapeJSON( modelFile.generic_string() ) );
+    report += fmt::format( "  \"width\": {},\n", width );
+    report += fmt::format( "  \"height\": {},\n", height );
+    report += fmt::format( "  \"frames\": {},\n", numFrames );
+    report += fmt::format( "  \"multisampling\": {},\n", multisample );
+    report += fmt::format( "  \"shadingMode\": \"{}\",\n", visibility ? "VisibilityBuffer" : "Forward" );
+    report += fmt::format( "  \"textureLayout\": \"{}\",\n", textureLayout == TextureLayout::Tiled ? "Tiled" : "Linear" );
+
+    // The number of levels of detail that were generated for each mesh (simplification stops early if a mesh can't be simplified).
+    std::string lodLevels;
+    for ( const auto& mesh: model.getMeshes() )
+        lodLevels += fmt::format( "{}{}", lodLevels.empty() ? "" : ", ", mesh->getLODs().size() );
+
+    report += "  \"lods\": {\n";
+    report += fmt::format( "    \"requested\": {},\n", numLODs );
+    report += fmt::format( "    \"generated\": [{}]\n", lodLevels );
+    report += "  },\n";
+    report += "  \"frameTime\": {\n";
+    report += fmt::format( "    \"min\": {:.3f},\n", sortedFrameTimes.front() );
+    report += fmt::format( "    \"mean\": {:.3f},\n", totalTime / n );
+    report += fmt::format( "    \"p50\": {:.3f},\n", percentile( sortedFrameTimes, 50.0 ) );
+    report += fmt::format( "    \"p90\": {:.3f},\n", percentile( sortedFrameTimes, 90.0 ) );
+    report += fmt::format( "    \"p95\": {:.3f},\n", percentile( sortedFrameTimes, 95.0 ) );
+    report += fmt::format( "    \"p99\": {:.3f},\n", percentile( sortedFrameTimes, 99.0 ) );
+    report += fmt::format( "    \"max\": {:.3f}\n", sortedFrameTimes.back() );
+    report += "  },\n";
+    report += "  \"statistics\": {\n";
+    report += fmt::format( "    \"meshesDrawn\": {:.1f},\n", avg( s.meshesDrawn ) );
+    report += fmt::format( "    \"meshesCulled\": {:.1f},\n", avg( s.meshesCulled ) );
+    report += fmt::format( "    \"meshesInside\": {:.1f},\n", avg( s.meshesInside ) );
+    report += fmt::format( "    \"meshesOccluded\": {:.1f},\n", avg( s.meshesOccluded ) );
+    report += fmt::format( "    \"meshesSimplified\": {:.1f},\n", avg( s.meshesSimplified ) );
+    report += fmt::format( "    \"meshletsDrawn\": {:.1f},\n", avg( s.meshletsDrawn ) );
+    report += fmt::format( "    \"meshletsCulled\": {:.1f},\n", avg( s.meshletsCulled ) );
+    report += fmt::format( "    \"verticesShaded\": {:.1f},\n", avg( s.verticesShaded ) );
+    report += fmt::format( "    \"fragmentsShaded\": {:.1f},\n", avg( s.fragmentsShaded ) );
+    report += fmt::format( "    \"trianglesSubmitted\": {:.1f},\n", avg( s.trianglesSubmitted ) );
+    report += fmt::format( "    \"trianglesClipped\": {:.1f},\n", avg( s.trianglesClipped ) );
+    report += fmt::format( "    \"trianglesCulled\": {:.1f},\n", avg( s.trianglesCulled ) );
+    report += fmt::format( "    \"trianglesRasterized\": {:.1f},\n", avg( s.trianglesRasterized ) );
+    report += fmt::format( "    \"pixelsTested\": {:.1f},\n", avg( s.pixelsTested ) );
+    report += fmt::format( "    \"pixelsPassed\": {:.1f},\n", avg( s.pixelsPassed ) );
+    report += fmt::format( "    \"pixelsWritten\": {:.1f},\n", avg( s.pixelsWritten ) );
+    report += fmt::format( "    \"vertexTime\": {:.3f},\n", avg( s.vertexTime ) );
+    report += fmt::format( "    \"clipTime\": {:.3f},\n", avg( s.clipTime ) );
+    report += fmt::format( "    \"setupTime\": {:.3f},\n", avg( s.setupTime ) );
+    report += fmt::format( "    \"rasterTime\": {:.3f},\n", avg( s.rasterTime ) );
+    report += fmt::format( "    \"shadeTime\": {:.3f}\n", avg( s.shadeTime ) );
+    report += textureImage ? "  },\n" : "  }\n";
+    if ( textureImage )
+    {
+        // Nanoseconds and simulated cache misses per bilinear texel fetch (see measureTextureFetch).
+        report += "  \"textureFetch\": {\n";
+        report += fmt::format( "    \"texture\": \"{}\",\n", escapeJSON( textureFile.generic_string() ) );
+        report += fmt::format( "    \"width\": {},\n", textureImage->getWidth() );
+        report += fmt::format( "    \"height\": {},\n", textureImage->getHeight() );
+        report += fmt::format( "    \"linear\": {{ \"uAlongX\": {:.3f}, \"vAlongX\": {:.3f}, \"missUAlongX\": {:.3f}, \"missVAlongX\": {:.3f} }},\n", linearFetch.uAlongX, linearFetch.vAlongX, linearFetch.missUAlongX, linearFetch.missVAlongX );
+        report += fmt::format( "    \"tiled\": {{ \"uAlongX\": {:.3f}, \"vAlongX\": {:.3f}, \"missUAlongX\": {:.3f}, \"missVAlongX\": {:.3f} }}\n", tiledFetch.uAlongX, tiledFetch.vAlongX, tiledFetch.missUAlongX, tiledFetch.missVAlongX );
+        report += "  }\n";
+    }
+    report += "}\n";
+
+    if ( !outputFile.empty() )
+    {
+        std::ofstream stream { outputFile };
+        if ( !stream )
+        {
+            std::cerr << "ERROR: Failed to open output file: " << outputFile << std::endl;
+            return 1;
+        }
+        stream << report;
+    }
+    else
+    {
+        std::cout << report;
+    }
+
+    return 0;
+}